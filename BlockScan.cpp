@@ -0,0 +1,221 @@
+/* Scanner of continued REPL lines, see BlockScan.h */
+#include <ctype.h>
+#include <string.h>
+#include "BlockScan.h"
+
+enum {
+  SCAN_BEG,     /* an expression may start: keywords open blocks */
+  SCAN_VALUE,   /* after a value: if/unless/while/until are modifiers */
+  SCAN_NAME     /* after a dot or def: the next word is a method name */
+};
+
+static struct {
+  int depth;            /* open keywords and brackets */
+  char quote;           /* open string delimiter or 0 */
+  bool unsure;
+} block_scan;
+
+void
+block_scan_reset(void)
+{
+  block_scan.depth = 0;
+  block_scan.quote = 0;
+  block_scan.unsure = false;
+}
+
+static bool
+is_word_char(char c)
+{
+  return isalnum((unsigned char)c) || c == '_' || (c & 0x80);
+}
+
+static bool
+word_is(const char *p, size_t len, const char *word)
+{
+  return strlen(word) == len && strncmp(p, word, len) == 0;
+}
+
+void
+block_scan_line(const char *p)
+{
+  int state = SCAN_BEG;
+  bool loop_cond = false;   /* while/until/for waiting for its "do" */
+
+  if (block_scan.unsure) return;
+  if (block_scan.quote == 0 && strncmp(p, "=begin", 6) == 0) {
+    block_scan.unsure = true;
+    return;
+  }
+  while (*p) {
+    char c = *p;
+
+    if (block_scan.quote) {
+      if (c == '\\' && p[1]) {
+        p += 2;
+        continue;
+      }
+      if (c == '#' && p[1] == '{' && block_scan.quote != '\'') {
+        block_scan.unsure = true;
+        return;
+      }
+      if (c == block_scan.quote) {
+        block_scan.quote = 0;
+        state = SCAN_VALUE;
+      }
+      p++;
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+      p++;
+      continue;
+    }
+    if (c == '#') break;
+    if (c == '\'' || c == '"' || c == '`') {
+      block_scan.quote = c;
+      p++;
+      continue;
+    }
+    if (is_word_char(c) || c == '@' || c == '$') {
+      const char *w = p;
+      size_t len;
+
+      if (c == '$') {
+        /* special variables such as $' and $" */
+        p += p[1] ? 2 : 1;
+      }
+      while (*p == '@') p++;
+      while (is_word_char(*p)) p++;
+      if ((*p == '?' || *p == '!') && p[1] != '=') p++;
+      len = p - w;
+      if (*p == ':' && p[1] != ':') {
+        /* hash label */
+        p++;
+        state = SCAN_BEG;
+        continue;
+      }
+      if (state == SCAN_NAME || isdigit((unsigned char)c)) {
+        state = SCAN_VALUE;
+        continue;
+      }
+      if (word_is(w, len, "def")) {
+        block_scan.depth++;
+        state = SCAN_NAME;
+      }
+      else if (word_is(w, len, "class") || word_is(w, len, "module") ||
+               word_is(w, len, "begin") || word_is(w, len, "case")) {
+        block_scan.depth++;
+        state = SCAN_BEG;
+      }
+      else if (word_is(w, len, "if") || word_is(w, len, "unless") ||
+               word_is(w, len, "while") || word_is(w, len, "until")) {
+        if (state == SCAN_BEG) {
+          block_scan.depth++;
+          loop_cond = word_is(w, len, "while") || word_is(w, len, "until");
+        }
+        state = SCAN_BEG;
+      }
+      else if (word_is(w, len, "for")) {
+        block_scan.depth++;
+        loop_cond = true;
+        state = SCAN_BEG;
+      }
+      else if (word_is(w, len, "do")) {
+        if (loop_cond) {
+          loop_cond = false;
+        }
+        else {
+          block_scan.depth++;
+        }
+        state = SCAN_BEG;
+      }
+      else if (word_is(w, len, "end")) {
+        block_scan.depth--;
+        state = SCAN_VALUE;
+      }
+      else if (word_is(w, len, "then") || word_is(w, len, "else") ||
+               word_is(w, len, "elsif") || word_is(w, len, "when") ||
+               word_is(w, len, "in") || word_is(w, len, "rescue") ||
+               word_is(w, len, "ensure") || word_is(w, len, "and") ||
+               word_is(w, len, "or") || word_is(w, len, "not")) {
+        state = SCAN_BEG;
+      }
+      else if (word_is(w, len, "__END__")) {
+        block_scan.unsure = true;
+        return;
+      }
+      else {
+        state = SCAN_VALUE;
+      }
+      continue;
+    }
+    switch (c) {
+    case '(': case '[': case '{':
+      block_scan.depth++;
+      state = SCAN_BEG;
+      break;
+    case ')': case ']': case '}':
+      block_scan.depth--;
+      state = SCAN_VALUE;
+      break;
+    case '\\':
+      if (p[1]) p++;
+      break;
+    case ':':
+      if (p[1] == ':') {
+        p++;
+        state = SCAN_NAME;
+      }
+      else if (is_word_char(p[1]) || p[1] == '@' || p[1] == '$') {
+        /* symbol */
+        state = SCAN_NAME;
+      }
+      else if (p[1] == '"' || p[1] == '\'') {
+        /* string symbol, the quote is read next */
+      }
+      else {
+        state = SCAN_BEG;
+      }
+      break;
+    case '.':
+      if (p[1] == '.') {
+        while (*p == '.') p++;
+        state = SCAN_BEG;
+        continue;
+      }
+      state = SCAN_NAME;
+      break;
+    case '%':
+    case '/':
+    case '?':
+      /* percent literal, regexp or character literal unless clearly
+         an operator after a value */
+      if (state != SCAN_VALUE || (p[-1] == ' ' && p[1] != ' ' && p[1] != '=')) {
+        block_scan.unsure = true;
+        return;
+      }
+      state = SCAN_BEG;
+      break;
+    case '<':
+      if (p[1] == '<' && p[2] != ' ' && p[2] != '=') {
+        /* may be a here document */
+        block_scan.unsure = true;
+        return;
+      }
+      state = SCAN_BEG;
+      break;
+    default:
+      state = SCAN_BEG;
+      break;
+    }
+    p++;
+  }
+  if (block_scan.depth < 0) {
+    block_scan.unsure = true;
+  }
+}
+
+bool
+block_surely_open(void)
+{
+  return !block_scan.unsure && (block_scan.depth > 0 || block_scan.quote);
+}
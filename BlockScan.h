@@ -0,0 +1,19 @@
+#ifndef BLOCKSCAN_H
+#define BLOCKSCAN_H
+
+// Cheap scan of each input line which tells if the code block is surely
+// still open, for example inside a class body. The accumulated block is
+// handed to the parser only when it might be complete, so entering a long
+// block costs one parse instead of one per line. Anything the scanner
+// does not fully understand (here documents, percent literals, regexps,
+// character literals, string interpolation, =begin) makes it unsure and
+// the parser decides as before.
+
+// Start of a new code block.
+void block_scan_reset(void);
+// Scan one more line of the block, without its newline or with it.
+void block_scan_line(const char *p);
+// True only if the block cannot be complete yet.
+bool block_surely_open(void);
+
+#endif
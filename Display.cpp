@@ -3,8 +3,12 @@
 #include <Wire.h>
 #include "SSD1306Ascii.h"
 #include "SSD1306AsciiWire.h"
+#include "Terminal.h"
 
 SSD1306AsciiWire oled;
+Terminal terminal;
+static bool display_dirty = false;
+static unsigned long display_refreshed = 0;
 
 
 void setup_display(void)
@@ -12,32 +16,27 @@ void setup_display(void)
   Wire.begin();
   oled.begin(&Adafruit128x64, I2C_ADDRESS);
   oled.setFont(TomThumbs3x6);
-  oled.setScroll(true);
-  oled.clear();
+  oled.setFramebuffer(true);
+  terminal.begin(&oled);
 }
 
-void display_write(char c)
+int display_columns(void)
 {
-  oled.write(c);
+  return terminal.cols();
 }
 
-void display_print(const char *s)
+// Sink for the output buffer. Text goes to the frame buffer at once, the
+// slow I2C transfer is done at most every DISPLAY_REFRESH_INTERVAL ms.
+size_t display_output(const uint8_t *buf, size_t len)
 {
-  oled.print(s);
-}
-
-void display_print(int i)
-{
-  oled.print(i);
-}
-
-void display_println(const char *s)
-{
-  oled.println(s);
-}
-
-void handle_backspace(void)
-{
-  oled.setCol(oled.col() - (oled.fontWidth() + 1));
-  oled.clearToEOL();
+  if (len > 0) {
+    terminal.write(buf, len);
+    display_dirty = true;
+  }
+  if (display_dirty && millis() - display_refreshed >= DISPLAY_REFRESH_INTERVAL) {
+    oled.flushDisplay();
+    display_refreshed = millis();
+    display_dirty = false;
+  }
+  return len;
 }
@@ -1,19 +1,16 @@
 #ifndef DISPLAY_H
 #define DISPLAY_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define I2C_ADDRESS 0x3C
 
-void setup_display(void);
-void handle_backspace(void);
-void display_write(char c);
-void display_print(const char *);
-void display_print(int);
-void display_println(const char *);
+// Least time between two transfers of the frame buffer
+#define DISPLAY_REFRESH_INTERVAL 100
 
-/* use Serial instead of stdout */
-#define stdout_putc(c)           { Serial.write(c); display_write(c); }
-#define stdout_write(s, len)     { Serial.write(s, len); for(int i=0;i<len;i++) display_write(s[i]); }
-#define stdout_print(s)          { Serial.print(s); display_print(s); }
-#define stdout_println(s)        { Serial.println(s); display_println(s); }
+void setup_display(void);
+int display_columns(void);
+size_t display_output(const uint8_t *, size_t);
 
 #endif
\ No newline at end of file
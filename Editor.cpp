@@ -0,0 +1,378 @@
+/* Line editor with history for mirb
+ *
+ * Keys: Left/Right, Home/End (also ^A/^E), ^B/^F, Up/Down (also ^P/^N)
+ * for history, Backspace, Delete, ^K, ^U and ^C to cancel.
+ *
+ * The line is shown in a window that scrolls horizontally, so it never
+ * wraps on the narrowest terminal. Edits inside the window are sent as
+ * VT100 insert/delete character sequences and the rest of the line is
+ * not redrawn.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "Editor.h"
+#include "Input.h"
+
+static void (*editor_output)(const char *, int);
+static int editor_columns = 80;
+
+// line being edited
+static const char *prompt;
+static int prompt_len;
+static char *line;
+static int line_size;
+static int len;
+static int pos;
+static int scroll;    // first visible character
+
+// history ring, entries are NUL terminated strings
+static char history[EDITOR_HISTORY_SIZE];
+static int history_head = 0;    // next byte to write
+static int history_tail = 0;    // first byte of the oldest entry
+static int history_used = 0;
+static int history_count = 0;
+static int history_index;       // -1 while editing a new line
+
+void
+setup_editor(void (*output)(const char *, int), int columns)
+{
+  editor_output = output;
+  editor_columns = columns;
+}
+
+static void
+out(const char *s, int n)
+{
+  editor_output(s, n);
+}
+
+static void
+out_str(const char *s)
+{
+  out(s, strlen(s));
+}
+
+static void
+out_csi(int n, char final)
+{
+  char buf[8];
+
+  if (n == 1) {
+    snprintf(buf, sizeof(buf), "\x1b[%c", final);
+  } else {
+    snprintf(buf, sizeof(buf), "\x1b[%d%c", n, final);
+  }
+  out_str(buf);
+}
+
+static int
+window(void)
+{
+  // the last column is never used, so the terminal never wraps
+  return editor_columns - prompt_len - 1;
+}
+
+// adjust the window to the cursor, true if it moved
+static bool
+follow_cursor(void)
+{
+  if (pos < scroll) {
+    scroll = pos;
+    return true;
+  }
+  if (pos - scroll > window()) {
+    scroll = pos - window();
+    return true;
+  }
+  return false;
+}
+
+static void
+refresh(void)
+{
+  int n = len - scroll;
+
+  if (n > window()) n = window();
+  out("\r", 1);
+  out(prompt, prompt_len);
+  out(line + scroll, n);
+  out_str("\x1b[K");
+  out("\r", 1);
+  if (prompt_len + pos - scroll > 0) {
+    out_csi(prompt_len + pos - scroll, 'C');
+  }
+}
+
+static void
+move_to(int p)
+{
+  int from = pos;
+
+  pos = p;
+  if (follow_cursor()) {
+    refresh();
+  } else if (pos < from) {
+    if (from - pos == 1) {
+      out("\b", 1);
+    } else {
+      out_csi(from - pos, 'D');
+    }
+  } else if (pos > from) {
+    out_csi(pos - from, 'C');
+  }
+}
+
+static void
+insert(char c)
+{
+  if (len >= line_size) return;
+  memmove(line + pos + 1, line + pos, len - pos);
+  line[pos] = c;
+  len++;
+  pos++;
+  if (follow_cursor() || (pos < len && len - scroll > window())) {
+    // a character moves into or out of the window
+    refresh();
+    return;
+  }
+  if (pos < len) {
+    out_csi(1, '@');
+  }
+  out(&c, 1);
+}
+
+// delete the character under the cursor
+static void
+erase(void)
+{
+  if (pos >= len) return;
+  memmove(line + pos, line + pos + 1, len - pos - 1);
+  len--;
+  if (len - scroll >= window()) {
+    // a hidden character moves into the window
+    refresh();
+    return;
+  }
+  out_csi(1, 'P');
+}
+
+static void
+set_line(const char *s)
+{
+  len = strlen(s);
+  if (len > line_size) len = line_size;
+  memmove(line, s, len);
+  pos = len;
+  scroll = 0;
+  follow_cursor();
+  refresh();
+}
+
+// copy the n-th newest history entry, false if there is none
+static bool
+history_get(int n, char *buf, int size)
+{
+  int end = history_head;
+  int start;
+
+  if (n < 0 || n >= history_count) return false;
+  for (int i = 0; i <= n; i++) {
+    // end is one past the terminating NUL of this entry
+    end = (end + EDITOR_HISTORY_SIZE - 1) % EDITOR_HISTORY_SIZE;
+    start = end;
+    while (start != history_tail &&
+           history[(start + EDITOR_HISTORY_SIZE - 1) % EDITOR_HISTORY_SIZE] != '\0') {
+      start = (start + EDITOR_HISTORY_SIZE - 1) % EDITOR_HISTORY_SIZE;
+    }
+    if (i < n) end = start;
+  }
+  int k = 0;
+  while (start != end && k < size - 1) {
+    buf[k++] = history[start];
+    start = (start + 1) % EDITOR_HISTORY_SIZE;
+  }
+  buf[k] = '\0';
+  return true;
+}
+
+static void
+history_drop_oldest(void)
+{
+  while (history[history_tail] != '\0') {
+    history_tail = (history_tail + 1) % EDITOR_HISTORY_SIZE;
+    history_used--;
+  }
+  history_tail = (history_tail + 1) % EDITOR_HISTORY_SIZE;
+  history_used--;
+  history_count--;
+}
+
+void
+editor_add_history(const char *s)
+{
+  int n = strlen(s);
+
+  while (n > 0 && (s[n - 1] == '\n' || s[n - 1] == '\r')) n--;
+  if (n == 0 || n + 1 > EDITOR_HISTORY_SIZE) return;
+  // skip a repeat of the newest entry
+  if (history_count > 0) {
+    int end = (history_head + EDITOR_HISTORY_SIZE - 1) % EDITOR_HISTORY_SIZE;
+    int p = end;
+    int i = n;
+    while (i > 0) {
+      p = (p + EDITOR_HISTORY_SIZE - 1) % EDITOR_HISTORY_SIZE;
+      if (history[p] != s[--i]) break;
+      if (i == 0 && (p == history_tail ||
+          history[(p + EDITOR_HISTORY_SIZE - 1) % EDITOR_HISTORY_SIZE] == '\0')) {
+        return;
+      }
+    }
+  }
+  while (history_used + n + 1 > EDITOR_HISTORY_SIZE) {
+    history_drop_oldest();
+  }
+  for (int i = 0; i <= n; i++) {
+    history[history_head] = i < n ? s[i] : '\0';
+    history_head = (history_head + 1) % EDITOR_HISTORY_SIZE;
+  }
+  history_used += n + 1;
+  history_count++;
+}
+
+static void
+history_move(int index)
+{
+  // the arena has no room for the line being edited, Down past the
+  // newest entry gives an empty line
+  if (index < -1 || index >= history_count) return;
+  history_index = index;
+  if (index < 0) {
+    set_line("");
+    return;
+  }
+  history_get(index, line, line_size + 1);
+  set_line(line);
+}
+
+// read the rest of an escape sequence and return its final byte
+static int
+read_escape(int *param)
+{
+  int c = input_getc();
+
+  *param = 0;
+  if (c != '[' && c != 'O') return 0;
+  while (true) {
+    c = input_getc();
+    if (c >= '0' && c <= '9') {
+      *param = *param * 10 + (c - '0');
+    } else if (c >= 0x40 && c <= 0x7e) {
+      return c;
+    }
+  }
+}
+
+// returns the line length, or -1 if canceled with ^C
+int
+editor_readline(const char *p, char *buf, int size)
+{
+  prompt = p;
+  prompt_len = strlen(p);
+  line = buf;
+  line_size = size - 1;
+  len = 0;
+  pos = 0;
+  scroll = 0;
+  history_index = -1;
+  out(prompt, prompt_len);
+
+  while (true) {
+    int c = input_getc();
+    int param;
+
+    switch (c) {
+    case 13:
+    case 10:
+      move_to(len);
+      out("\r\n", 2);
+      buf[len] = '\0';
+      return len;
+    case 3:     // ^C
+      move_to(len);
+      buf[len] = '\0';
+      return -1;
+    case 127:
+    case 8:
+      if (pos > 0) {
+        move_to(pos - 1);
+        erase();
+      }
+      break;
+    case 1:     // ^A
+      move_to(0);
+      break;
+    case 5:     // ^E
+      move_to(len);
+      break;
+    case 2:     // ^B
+      if (pos > 0) move_to(pos - 1);
+      break;
+    case 6:     // ^F
+      if (pos < len) move_to(pos + 1);
+      break;
+    case 11:    // ^K
+      len = pos;
+      out_str("\x1b[K");
+      break;
+    case 21:    // ^U
+      memmove(line, line + pos, len - pos);
+      len -= pos;
+      pos = 0;
+      scroll = 0;
+      refresh();
+      break;
+    case 16:    // ^P
+      history_move(history_index + 1);
+      break;
+    case 14:    // ^N
+      history_move(history_index - 1);
+      break;
+    case 27:
+      switch (read_escape(&param)) {
+      case 'A':
+        history_move(history_index + 1);
+        break;
+      case 'B':
+        history_move(history_index - 1);
+        break;
+      case 'C':
+        if (pos < len) move_to(pos + 1);
+        break;
+      case 'D':
+        if (pos > 0) move_to(pos - 1);
+        break;
+      case 'H':
+        move_to(0);
+        break;
+      case 'F':
+        move_to(len);
+        break;
+      case '~':
+        if (param == 1 || param == 7) {
+          move_to(0);
+        } else if (param == 4 || param == 8) {
+          move_to(len);
+        } else if (param == 3) {
+          erase();
+        }
+        break;
+      }
+      break;
+    default:
+      if (c >= ' ' && c < 127) {
+        insert(c);
+      }
+      break;
+    }
+  }
+}
@@ -0,0 +1,11 @@
+#ifndef EDITOR_H
+#define EDITOR_H
+
+// History arena shared by all entries, oldest entries are dropped first
+#define EDITOR_HISTORY_SIZE 1024
+
+void setup_editor(void (*output)(const char *, int), int columns);
+int editor_readline(const char *prompt, char *buf, int size);
+void editor_add_history(const char *line);
+
+#endif
@@ -0,0 +1,616 @@
+/* Heap for mruby: size-class pools for small blocks, TLSF for the rest */
+#include <stdint.h>
+#include <string.h>
+#include "Heap.h"
+
+// Bounds of the free RAM, defined in linker_arduino.gsi
+extern "C" char mrb_heap_start[];
+extern "C" char mrb_heap_end[];
+
+static size_t heap_total = 0;
+static size_t heap_used = 0;
+static size_t heap_peak = 0;
+static unsigned long heap_failures = 0;
+
+static void
+account(long delta)
+{
+  heap_used += delta;
+  if (heap_used > heap_peak) {
+    heap_peak = heap_used;
+  }
+}
+
+/*
+ * Size-class pools
+ *
+ * Each page holds slots of one size class. Pages with free slots are
+ * linked per class, a page whose slots are all freed goes back to the
+ * list of empty pages and may serve another class.
+ */
+#define POOL_CLASSES (HEAP_POOL_MAX_SIZE / HEAP_ALIGN)
+#define POOL_NONE    0xff
+
+struct pool_page {
+  void *free;       // slots returned by pool_free()
+  uint16_t bump;    // offset of the first slot never handed out
+  uint16_t used;    // slots handed out
+  uint8_t cls;      // size class, or POOL_NONE
+  uint8_t next;     // next page of the class or of the empty list
+};
+
+static char *pool_base;
+static struct pool_page pool_page[HEAP_POOL_PAGES];
+static uint8_t pool_head[POOL_CLASSES];
+static uint8_t pool_empty;
+
+static bool
+in_pool(void *p)
+{
+  return (char *)p >= pool_base &&
+         (char *)p < pool_base + HEAP_POOL_PAGES * HEAP_POOL_PAGE_SIZE;
+}
+
+static bool
+page_full(struct pool_page *pg, size_t slot)
+{
+  return pg->free == NULL && pg->bump + slot > HEAP_POOL_PAGE_SIZE;
+}
+
+static void *
+pool_alloc(size_t size)
+{
+  uint8_t c = (size - 1) / HEAP_ALIGN;
+  size_t slot = (c + 1) * HEAP_ALIGN;
+  uint8_t i = pool_head[c];
+
+  if (i == POOL_NONE) {
+    i = pool_empty;
+    if (i == POOL_NONE) return NULL;
+    pool_empty = pool_page[i].next;
+    pool_page[i].free = NULL;
+    pool_page[i].bump = 0;
+    pool_page[i].used = 0;
+    pool_page[i].cls = c;
+    pool_page[i].next = POOL_NONE;
+    pool_head[c] = i;
+  }
+
+  struct pool_page *pg = &pool_page[i];
+  void *p;
+  if (pg->free) {
+    p = pg->free;
+    pg->free = *(void **)p;
+  } else {
+    p = pool_base + i * HEAP_POOL_PAGE_SIZE + pg->bump;
+    pg->bump += slot;
+  }
+  pg->used++;
+  if (page_full(pg, slot)) {
+    pool_head[c] = pg->next;
+  }
+  account(slot);
+  return p;
+}
+
+static void
+pool_free(void *p)
+{
+  uint8_t i = ((char *)p - pool_base) / HEAP_POOL_PAGE_SIZE;
+  struct pool_page *pg = &pool_page[i];
+  uint8_t c = pg->cls;
+  size_t slot = (c + 1) * HEAP_ALIGN;
+  bool was_full = page_full(pg, slot);
+
+  *(void **)p = pg->free;
+  pg->free = p;
+  pg->used--;
+  account(-(long)slot);
+
+  if (pg->used == 0) {
+    if (!was_full) {
+      uint8_t *link = &pool_head[c];
+      while (*link != i) {
+        link = &pool_page[*link].next;
+      }
+      *link = pg->next;
+    }
+    pg->cls = POOL_NONE;
+    pg->next = pool_empty;
+    pool_empty = i;
+  } else if (was_full) {
+    pg->next = pool_head[c];
+    pool_head[c] = i;
+  }
+}
+
+static size_t
+pool_slot_size(void *p)
+{
+  uint8_t i = ((char *)p - pool_base) / HEAP_POOL_PAGE_SIZE;
+  return (pool_page[i].cls + 1) * HEAP_ALIGN;
+}
+
+/*
+ * Parser arena
+ *
+ * While the REPL parses a line, large blocks (the parser's memory pool
+ * pages and token buffer) are cut from a fixed region by moving a
+ * pointer. They are all freed with the parser, and the region is
+ * rewound as soon as nothing in it is in use, so parsing does not
+ * touch the TLSF heap. A block that outlives the parser only delays
+ * the rewind until it is freed.
+ */
+#define ARENA_HEADER HEAP_ALIGN   // holds the block size
+
+static char *arena_base;
+static size_t arena_top = 0;
+static unsigned int arena_live = 0;
+static bool arena_active = false;
+static size_t arena_line = 0;
+static size_t arena_peak = 0;
+static unsigned long arena_spills = 0;
+
+static bool
+in_arena(void *p)
+{
+  return (char *)p >= arena_base && (char *)p < arena_base + HEAP_ARENA_SIZE;
+}
+
+static void *
+arena_alloc(size_t size)
+{
+  if (arena_top + ARENA_HEADER + size > HEAP_ARENA_SIZE) {
+    arena_spills++;
+    return NULL;
+  }
+  char *p = arena_base + arena_top;
+  *(size_t *)p = size;
+  arena_top += ARENA_HEADER + size;
+  arena_live++;
+  arena_line += size;
+  if (arena_top > arena_peak) {
+    arena_peak = arena_top;
+  }
+  return p + ARENA_HEADER;
+}
+
+static size_t
+arena_block_size(void *p)
+{
+  return *(size_t *)((char *)p - ARENA_HEADER);
+}
+
+static void
+arena_free(void *p)
+{
+  if (--arena_live == 0) {
+    arena_top = 0;
+  }
+}
+
+void
+heap_arena_begin(void)
+{
+  arena_active = true;
+  arena_line = 0;
+}
+
+void
+heap_arena_end(void)
+{
+  arena_active = false;
+}
+
+size_t
+heap_arena_used(void)
+{
+  return arena_line;
+}
+
+/*
+ * TLSF (two-level segregated fit)
+ *
+ * Free blocks are kept in lists indexed by the highest bit of their
+ * size (first level) and the next TLSF_SL_SHIFT bits (second level).
+ * Two bitmaps find a large enough list in constant time, and a freed
+ * block is merged with its free neighbours at once, so no two free
+ * blocks are ever adjacent.
+ */
+#define TLSF_SL_SHIFT 3
+#define TLSF_SL_COUNT (1 << TLSF_SL_SHIFT)
+#define TLSF_FL_SHIFT (TLSF_SL_SHIFT + 3)   // log2(HEAP_ALIGN)
+#define TLSF_SMALL    (1 << TLSF_FL_SHIFT)  // sizes below share one list row
+#define TLSF_FL_COUNT 14                    // blocks below 512 KB
+
+struct block {
+  size_t size;              // payload bytes | BLOCK_FREE
+  struct block *prev;       // physically previous block
+  struct block *next_free;  // free list links, only while free
+  struct block *prev_free;
+};
+
+#define BLOCK_FREE   1
+#define BLOCK_HEADER offsetof(struct block, next_free)
+#define BLOCK_MIN    (sizeof(struct block) - BLOCK_HEADER)
+
+static struct block *tlsf_list[TLSF_FL_COUNT][TLSF_SL_COUNT];
+static uint32_t tlsf_fl_map;
+static uint8_t tlsf_sl_map[TLSF_FL_COUNT];
+static struct block *tlsf_first;
+static struct block *tlsf_last;
+
+static inline size_t
+block_size(struct block *b)
+{
+  return b->size & ~(size_t)BLOCK_FREE;
+}
+
+static inline struct block *
+block_next(struct block *b)
+{
+  return (struct block *)((char *)b + BLOCK_HEADER + block_size(b));
+}
+
+static inline int
+fls(size_t n)
+{
+  return 31 - __builtin_clz(n);
+}
+
+static void
+mapping(size_t size, int *fl, int *sl)
+{
+  if (size < TLSF_SMALL) {
+    *fl = 0;
+    *sl = size / HEAP_ALIGN;
+  } else {
+    int f = fls(size);
+    *sl = (size >> (f - TLSF_SL_SHIFT)) ^ TLSF_SL_COUNT;
+    *fl = f - (TLSF_FL_SHIFT - 1);
+  }
+}
+
+static void
+link_free(struct block *b)
+{
+  int fl, sl;
+  mapping(block_size(b), &fl, &sl);
+  b->size |= BLOCK_FREE;
+  b->prev_free = NULL;
+  b->next_free = tlsf_list[fl][sl];
+  if (b->next_free) {
+    b->next_free->prev_free = b;
+  }
+  tlsf_list[fl][sl] = b;
+  tlsf_fl_map |= 1UL << fl;
+  tlsf_sl_map[fl] |= 1 << sl;
+}
+
+static void
+unlink_free(struct block *b)
+{
+  int fl, sl;
+  mapping(block_size(b), &fl, &sl);
+  if (b->prev_free) {
+    b->prev_free->next_free = b->next_free;
+  } else {
+    tlsf_list[fl][sl] = b->next_free;
+    if (b->next_free == NULL) {
+      tlsf_sl_map[fl] &= ~(1 << sl);
+      if (tlsf_sl_map[fl] == 0) {
+        tlsf_fl_map &= ~(1UL << fl);
+      }
+    }
+  }
+  if (b->next_free) {
+    b->next_free->prev_free = b->prev_free;
+  }
+  b->size &= ~(size_t)BLOCK_FREE;
+}
+
+// Put a block on a free list after merging it with free neighbours
+static void
+release(struct block *b)
+{
+  struct block *n = block_next(b);
+  if (n->size & BLOCK_FREE) {
+    unlink_free(n);
+    b->size += BLOCK_HEADER + n->size;
+  }
+  if (b->prev && (b->prev->size & BLOCK_FREE)) {
+    struct block *p = b->prev;
+    unlink_free(p);
+    p->size += BLOCK_HEADER + b->size;
+    b = p;
+  }
+  block_next(b)->prev = b;
+  link_free(b);
+}
+
+// Cut a used block down to size and free the rest
+static void
+trim(struct block *b, size_t size)
+{
+  size_t rest = b->size - size;
+  if (rest < BLOCK_HEADER + BLOCK_MIN) return;
+
+  struct block *r = (struct block *)((char *)b + BLOCK_HEADER + size);
+  r->size = rest - BLOCK_HEADER;
+  r->prev = b;
+  b->size = size;
+  release(r);
+}
+
+static void *
+tlsf_alloc(size_t size)
+{
+  int fl, sl;
+
+  if (size < BLOCK_MIN) {
+    size = BLOCK_MIN;
+  }
+  size_t s = size;
+  // round up to the next list, any block found there is large enough
+  if (s >= TLSF_SMALL) {
+    s += (1 << (fls(s) - TLSF_SL_SHIFT)) - 1;
+  }
+  mapping(s, &fl, &sl);
+  if (fl >= TLSF_FL_COUNT) return NULL;
+
+  uint32_t sl_map = tlsf_sl_map[fl] & (~0U << sl);
+  if (sl_map == 0) {
+    uint32_t fl_map = tlsf_fl_map & (~0UL << (fl + 1));
+    if (fl_map == 0) return NULL;
+    fl = __builtin_ctz(fl_map);
+    sl_map = tlsf_sl_map[fl];
+  }
+  sl = __builtin_ctz(sl_map);
+
+  struct block *b = tlsf_list[fl][sl];
+  unlink_free(b);
+  trim(b, size);
+  account(b->size);
+  return (char *)b + BLOCK_HEADER;
+}
+
+static void
+tlsf_free(void *p)
+{
+  struct block *b = (struct block *)((char *)p - BLOCK_HEADER);
+  account(-(long)b->size);
+  release(b);
+}
+
+static void *heap_malloc(size_t size);
+
+static void *
+tlsf_realloc(void *p, size_t size)
+{
+  struct block *b = (struct block *)((char *)p - BLOCK_HEADER);
+  size_t old = b->size;
+
+  if (size < BLOCK_MIN) {
+    size = BLOCK_MIN;
+  }
+  if (size <= old) {
+    trim(b, size);
+    account(b->size - old);
+    return p;
+  }
+
+  // grow in place into a free block that follows
+  struct block *n = block_next(b);
+  if ((n->size & BLOCK_FREE) && old + BLOCK_HEADER + block_size(n) >= size) {
+    unlink_free(n);
+    b->size += BLOCK_HEADER + n->size;
+    block_next(b)->prev = b;
+    trim(b, size);
+    account(b->size - old);
+    return p;
+  }
+
+  void *q = heap_malloc(size);
+  if (q == NULL) return NULL;
+  memcpy(q, p, old);
+  tlsf_free(p);
+  return q;
+}
+
+static void *
+heap_malloc(size_t size)
+{
+  void *p = NULL;
+
+  if (size <= HEAP_POOL_MAX_SIZE) {
+    p = pool_alloc(size);
+  }
+  if (p == NULL) {
+    p = tlsf_alloc(size);
+  }
+  if (p == NULL) {
+    heap_failures++;
+  }
+  return p;
+}
+
+void
+setup_heap(void)
+{
+  uintptr_t start = ((uintptr_t)mrb_heap_start + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1);
+  uintptr_t end = (uintptr_t)mrb_heap_end & ~(HEAP_ALIGN - 1);
+
+  // also called again when restoring a snapshot failed half way
+  heap_used = 0;
+  heap_peak = 0;
+  heap_failures = 0;
+  arena_top = 0;
+  arena_live = 0;
+  arena_active = false;
+  arena_peak = 0;
+  arena_spills = 0;
+  memset(tlsf_list, 0, sizeof(tlsf_list));
+  tlsf_fl_map = 0;
+  memset(tlsf_sl_map, 0, sizeof(tlsf_sl_map));
+
+  pool_base = (char *)start;
+  for (int i = 0; i < HEAP_POOL_PAGES; i++) {
+    pool_page[i].cls = POOL_NONE;
+    pool_page[i].next = i + 1 < HEAP_POOL_PAGES ? i + 1 : POOL_NONE;
+  }
+  pool_empty = 0;
+  memset(pool_head, POOL_NONE, sizeof(pool_head));
+
+  arena_base = pool_base + HEAP_POOL_PAGES * HEAP_POOL_PAGE_SIZE;
+
+  // one free block over the rest of the RAM, closed by a used block of
+  // size zero so that merging stops at the end
+  tlsf_first = (struct block *)(arena_base + HEAP_ARENA_SIZE);
+  tlsf_first->prev = NULL;
+  tlsf_first->size = end - (uintptr_t)tlsf_first - 2 * BLOCK_HEADER;
+  tlsf_last = block_next(tlsf_first);
+  tlsf_last->size = 0;
+  tlsf_last->prev = tlsf_first;
+  link_free(tlsf_first);
+
+  heap_total = end - start;
+}
+
+// mrb_allocf for mrb_open_allocf()
+void *
+heap_allocf(struct mrb_state *mrb, void *p, size_t size, void *ud)
+{
+  if (size == 0) {
+    if (p == NULL) return NULL;
+    if (in_pool(p)) {
+      pool_free(p);
+    } else if (in_arena(p)) {
+      arena_free(p);
+    } else {
+      tlsf_free(p);
+    }
+    return NULL;
+  }
+
+  size = (size + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1);
+  if (p == NULL) {
+    if (arena_active && size >= HEAP_ARENA_MIN_BLOCK) {
+      void *q = arena_alloc(size);
+      if (q) return q;
+    }
+    return heap_malloc(size);
+  }
+  if (in_arena(p)) {
+    // a resized block may be kept, so it moves to the heap
+    size_t old = arena_block_size(p);
+    void *q = heap_malloc(size);
+    if (q == NULL) return NULL;
+    memcpy(q, p, old < size ? old : size);
+    arena_free(p);
+    return q;
+  }
+  if (in_pool(p)) {
+    size_t slot = pool_slot_size(p);
+    if (size <= slot) return p;
+    void *q = heap_malloc(size);
+    if (q == NULL) return NULL;
+    memcpy(q, p, slot);
+    pool_free(p);
+    return q;
+  }
+  return tlsf_realloc(p, size);
+}
+
+void
+heap_stat(struct heap_stat *stat)
+{
+  memset(stat, 0, sizeof(*stat));
+  stat->total = heap_total;
+  stat->used = heap_used;
+  stat->peak = heap_peak;
+  stat->failures = heap_failures;
+  stat->arena_used = arena_top;
+  stat->arena_peak = arena_peak;
+  stat->arena_spills = arena_spills;
+
+  for (struct block *b = tlsf_first; b != tlsf_last; b = block_next(b)) {
+    if (b->size & BLOCK_FREE) {
+      stat->free += block_size(b);
+      stat->free_blocks++;
+      if (block_size(b) > stat->largest_free) {
+        stat->largest_free = block_size(b);
+      }
+    }
+  }
+
+  for (int i = 0; i < HEAP_POOL_PAGES; i++) {
+    if (pool_page[i].cls == POOL_NONE) continue;
+    size_t slot = (pool_page[i].cls + 1) * HEAP_ALIGN;
+    stat->pool_pages++;
+    stat->pool_used += pool_page[i].used * slot;
+    stat->pool_free += (HEAP_POOL_PAGE_SIZE / slot - pool_page[i].used) * slot;
+  }
+}
+
+/*
+ * Snapshot
+ *
+ * The heap sits at the same address in every boot of the same build, so
+ * its bytes and the variables below are all it takes to bring it back.
+ * Only the part below the links of the last free block is saved.
+ */
+static const struct {
+  void *p;
+  size_t size;
+} heap_vars[] = {
+  { &heap_used, sizeof(heap_used) },
+  { &heap_peak, sizeof(heap_peak) },
+  { &heap_failures, sizeof(heap_failures) },
+  { pool_page, sizeof(pool_page) },
+  { pool_head, sizeof(pool_head) },
+  { &pool_empty, sizeof(pool_empty) },
+  { &arena_top, sizeof(arena_top) },
+  { &arena_live, sizeof(arena_live) },
+  { &arena_peak, sizeof(arena_peak) },
+  { &arena_spills, sizeof(arena_spills) },
+  { tlsf_list, sizeof(tlsf_list) },
+  { &tlsf_fl_map, sizeof(tlsf_fl_map) },
+  { tlsf_sl_map, sizeof(tlsf_sl_map) },
+};
+
+static size_t
+heap_span(void)
+{
+  char *top = (char *)tlsf_last;
+  struct block *b = tlsf_last->prev;
+  if (b->size & BLOCK_FREE) {
+    top = (char *)b + sizeof(struct block);
+  }
+  return top - pool_base;
+}
+
+bool
+heap_save(bool (*write)(const void *buf, size_t size))
+{
+  for (size_t i = 0; i < sizeof(heap_vars) / sizeof(heap_vars[0]); i++) {
+    if (!write(heap_vars[i].p, heap_vars[i].size)) return false;
+  }
+  size_t span = heap_span();
+  return write(&span, sizeof(span)) &&
+         write(pool_base, span) &&
+         write(tlsf_last, BLOCK_HEADER);
+}
+
+// Call setup_heap() again if this fails
+bool
+heap_restore(bool (*read)(void *buf, size_t size))
+{
+  for (size_t i = 0; i < sizeof(heap_vars) / sizeof(heap_vars[0]); i++) {
+    if (!read(heap_vars[i].p, heap_vars[i].size)) return false;
+  }
+  size_t span;
+  if (!read(&span, sizeof(span)) || span > (size_t)((char *)tlsf_last - pool_base)) {
+    return false;
+  }
+  return read(pool_base, span) && read(tlsf_last, BLOCK_HEADER);
+}
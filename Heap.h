@@ -0,0 +1,46 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stddef.h>
+
+// Small blocks up to HEAP_POOL_MAX_SIZE bytes come from size-class pools,
+// in steps of HEAP_ALIGN bytes. The pools take the first HEAP_POOL_PAGES
+// pages of the heap, everything larger is handled by a TLSF allocator.
+#define HEAP_ALIGN          8
+#define HEAP_POOL_MAX_SIZE  64
+#define HEAP_POOL_PAGE_SIZE 1024
+#define HEAP_POOL_PAGES     24
+
+// Region for the parser's large blocks while heap_arena_begin() is in
+// effect, sized for one mruby pool page (16000 bytes) and a token buffer.
+#define HEAP_ARENA_SIZE      (20 * 1024)
+#define HEAP_ARENA_MIN_BLOCK 1024
+
+struct heap_stat {
+  size_t total;               // bytes managed by the heap
+  size_t used;                // bytes handed out, rounded to the block size
+  size_t peak;                // highest value of used
+  size_t free;                // free TLSF bytes
+  size_t largest_free;        // largest free TLSF block
+  unsigned int free_blocks;   // number of free TLSF blocks
+  unsigned int pool_pages;    // pool pages given to a size class
+  size_t pool_used;           // bytes in pool slots handed out
+  size_t pool_free;           // bytes in free slots of those pages
+  unsigned long failures;     // allocations that could not be served
+  size_t arena_used;          // bytes of the parser arena in use
+  size_t arena_peak;          // highest value of arena_used
+  unsigned long arena_spills; // parser blocks that did not fit the arena
+};
+
+struct mrb_state;
+
+void setup_heap(void);
+void *heap_allocf(struct mrb_state *mrb, void *p, size_t size, void *ud);
+void heap_stat(struct heap_stat *stat);
+void heap_arena_begin(void);
+void heap_arena_end(void);
+size_t heap_arena_used(void);
+bool heap_save(bool (*write)(const void *buf, size_t size));
+bool heap_restore(bool (*read)(void *buf, size_t size));
+
+#endif
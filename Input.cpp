@@ -0,0 +1,146 @@
+/* Input ring buffer fed by the USB keyboard and the serial RX interrupt */
+#include "Arduino.h"
+#include "Input.h"
+
+// Defined by Keyboard.cpp when USB keyboard support is linked in
+void keyboard_task(void) __attribute__((weak));
+// Defined by Output.cpp, drains the console output while we wait
+bool output_task(void) __attribute__((weak));
+
+static uint8_t input_buffer[INPUT_BUFFER_SIZE];
+static volatile uint8_t input_head = 0;
+static volatile uint8_t input_tail = 0;
+static volatile unsigned long input_lost = 0;
+static int input_serial_channel = -1;
+static input_flow input_flow_fn = NULL;
+static volatile bool input_stop_wanted = false;  // set by input_put()
+static bool input_stopped = false;               // last sent to the sender
+
+void
+setup_input(int serial_channel)
+{
+  input_serial_channel = serial_channel;
+}
+
+// Called from the SCI receive interrupt
+bool
+serialRxHook(int serial_channel, unsigned char c)
+{
+  if (serial_channel != input_serial_channel) {
+    return false;
+  }
+  input_put(c);
+  return true;
+}
+
+// Safe to call from both interrupt and main context
+bool
+input_put(uint8_t c)
+{
+  bool di = isNoInterrupts();
+  noInterrupts();
+
+  uint8_t next = (input_head + 1) & (INPUT_BUFFER_SIZE - 1);
+  bool ret = next != input_tail;
+  if (ret) {
+    input_buffer[input_head] = c;
+    input_head = next;
+  } else {
+    input_lost++;
+  }
+  if (input_flow_fn && input_available() >= INPUT_FLOW_HIGH) {
+    input_stop_wanted = true;
+  }
+
+  if (!di) {
+    interrupts();
+  }
+  return ret;
+}
+
+int
+input_available(void)
+{
+  return (input_head - input_tail) & (INPUT_BUFFER_SIZE - 1);
+}
+
+// Send XOFF or XON when the wanted state changed. The writer shares the
+// transmit buffer with the console output, so this never runs in the
+// receive interrupt.
+static void
+input_flow_task(void)
+{
+  bool stop = input_stop_wanted;
+  if (input_flow_fn && stop != input_stopped && input_flow_fn(stop)) {
+    input_stopped = stop;
+  }
+}
+
+int
+input_read(void)
+{
+  if (input_head == input_tail) {
+    return -1;
+  }
+  uint8_t c = input_buffer[input_tail];
+  input_tail = (input_tail + 1) & (INPUT_BUFFER_SIZE - 1);
+
+  if (input_stop_wanted && input_available() <= INPUT_FLOW_LOW) {
+    input_stop_wanted = false;
+  }
+  input_flow_task();
+  return c;
+}
+
+// Wait for the next key, sleeping the CPU between events.
+// The 1ms timer interrupt wakes us to service the USB host.
+int
+input_getc(void)
+{
+  while (true) {
+    if (keyboard_task) {
+      keyboard_task();
+    }
+    if (output_task) {
+      output_task();
+    }
+    input_flow_task();
+    noInterrupts();
+    if (input_head != input_tail) {
+      interrupts();
+      break;
+    }
+    // WAIT enables interrupts, so a byte arriving after the check
+    // still wakes the CPU
+    wait();
+  }
+  return input_read();
+}
+
+unsigned long
+input_dropped(void)
+{
+  return input_lost;
+}
+
+// NULL turns flow control off, a stopped sender is started first. XON
+// must not be lost, so this waits for room in the transmit buffer.
+void
+input_flow_control(input_flow flow)
+{
+  if (input_flow_fn && input_stopped) {
+    while (!input_flow_fn(false)) {
+      if (output_task) {
+        output_task();
+      }
+    }
+  }
+  bool di = isNoInterrupts();
+  noInterrupts();
+  input_stop_wanted = false;
+  input_stopped = false;
+  input_flow_fn = flow;
+  if (!di) {
+    interrupts();
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+
+// Keys from the USB keyboard and the serial port, in arrival order.
+// Must be a power of two, up to 256.
+#define INPUT_BUFFER_SIZE 256
+
+// With flow control on, the sender is stopped when this many keys wait
+// and started again when they have been read down to INPUT_FLOW_LOW
+#define INPUT_FLOW_HIGH (INPUT_BUFFER_SIZE / 2)
+#define INPUT_FLOW_LOW  (INPUT_BUFFER_SIZE / 8)
+
+// Sends XOFF (stop) or XON, returns false if it could not be sent yet.
+// Called from the main loop only, the receive interrupt just asks for it.
+typedef bool (*input_flow)(bool stop);
+
+void setup_input(int serial_channel);
+bool input_put(uint8_t c);
+int input_available(void);
+int input_read(void);
+int input_getc(void);
+unsigned long input_dropped(void);
+void input_flow_control(input_flow flow);
+
+#endif
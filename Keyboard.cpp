@@ -1,8 +1,6 @@
 /* USB Host support */
 #include <hidboot.h>
-
-uint8_t last_key = 0;
-uint8_t get_last_key() { uint8_t ret = last_key; last_key = 0; return ret; }
+#include "Input.h"
 
 class KbdRptParser : public KeyboardReportParser {
   protected:
@@ -13,19 +11,36 @@ void KbdRptParser::OnKeyDown(uint8_t mod, uint8_t key)
   // Serial.print(key);
   // WIP: temporarily code
   if (key == 40) {
-    last_key = 13;  // Enter
+    input_put(13);  // Enter
+  }
+  else if (key == 42) {
+    input_put(127);  // Backspace
   }
-  else if (key == 42 || key == 76) {
-    last_key = 127;  // Backspace or Delete
+  else if (key == 76) {
+    // Delete as the VT100 sequence, the editor deletes forward
+    input_put(27);
+    input_put('[');
+    input_put('3');
+    input_put('~');
+  }
+  else if (key >= 79 && key <= 82) {
+    // Right, Left, Down, Up as VT100 cursor keys
+    input_put(27);
+    input_put('[');
+    input_put("CDBA"[key - 79]);
   }
   else {
-    last_key = OemToAscii(mod, key);
+    uint8_t c = OemToAscii(mod, key);
+    if (c > 0) {
+      input_put(c);
+    }
   }
 }
 
 USB Usb;
 HIDBoot<HID_PROTOCOL_KEYBOARD>    HidKeyboard(&Usb);
 KbdRptParser KbdPrs;
+static bool keyboard_ready = false;
 
 void
 setup_keyboard(void)
@@ -37,9 +52,14 @@ setup_keyboard(void)
   delay( 200 );
 
   HidKeyboard.SetReportParser(0, (HIDReportParser*)&KbdPrs);
+  keyboard_ready = true;
 }
 
+// input_getc() calls this even when the USB port is used as the console
 void keyboard_task(void)
 {
+  if (!keyboard_ready) {
+    return;
+  }
   Usb.Task();
 }
\ No newline at end of file
@@ -4,7 +4,6 @@
 // Define serial port
 #define Serial Serial1
 
-uint8_t get_last_key(void);
 void setup_keyboard(void);
 void keyboard_task(void);
 
@@ -0,0 +1,331 @@
+/* Run precompiled mruby bytecode (.mrb) from ROM or the SD card */
+#include "Arduino.h"
+#include <SD.h>
+
+#include <mruby.h>
+#include <mruby/array.h>
+#include <mruby/dump.h>
+#include <mruby/irep.h>
+#include <mruby/proc.h>
+#include <mruby/string.h>
+#include <mruby/variable.h>
+
+#include "Loader.h"
+
+#ifndef LOADER_SD_CS_PIN
+#define LOADER_SD_CS_PIN SD_CHIP_SELECT_PIN
+#endif
+
+// Bounds of the .mrbrom section, defined in linker_arduino.gsi
+extern "C" const struct loader_rom_image mrbrom_start[];
+extern "C" const struct loader_rom_image mrbrom_end[];
+
+static bool sd_ready = false;
+static struct loader_info loader_info_table[LOADER_MAX_INFO];
+static int loader_info_count = 0;
+
+// Images read from SD are never freed because mrb_read_irep() leaves iseq
+// and symbol names in place. Loading an unchanged file again reuses the
+// copy kept here. A changed file, or one past LOADER_MAX_INFO names, takes
+// a new copy and the old one stays in the heap.
+struct sd_image {
+  char name[16];
+  uint8_t *bin;
+  uint32_t size;
+};
+static struct sd_image sd_image_table[LOADER_MAX_INFO];
+static int sd_image_count = 0;
+
+static const uint8_t *
+find_rom(const char *name)
+{
+  for (const struct loader_rom_image *i = mrbrom_start; i < mrbrom_end; i++) {
+    if (strcmp(i->name, name) == 0) {
+      return i->bin;
+    }
+  }
+  return NULL;
+}
+
+// mrb_read_irep() trusts the size in the header when it checks the CRC
+static bool
+valid_image(const uint8_t *bin, uint32_t size)
+{
+  const struct rite_binary_header *header = (const struct rite_binary_header *)bin;
+
+  return size >= sizeof(*header) &&
+         memcmp(header->binary_ident, RITE_BINARY_IDENT, sizeof(header->binary_ident)) == 0 &&
+         bin_to_uint32(header->binary_size) <= size;
+}
+
+// SD.begin() fails once the card is set up, so everybody starts it here
+bool
+loader_sd_begin(void)
+{
+  if (!sd_ready) {
+    sd_ready = SD.begin(LOADER_SD_CS_PIN);
+  }
+  return sd_ready;
+}
+
+static struct sd_image *
+find_sd_image(const char *name)
+{
+  for (int i = 0; i < sd_image_count; i++) {
+    if (strcmp(sd_image_table[i].name, name) == 0) {
+      return &sd_image_table[i];
+    }
+  }
+  return NULL;
+}
+
+// Remember an image that loaded, replacing an older copy of the same file
+static void
+keep_sd_image(const char *name, uint8_t *bin, uint32_t size)
+{
+  if (strlen(name) >= sizeof(sd_image_table[0].name)) return;
+
+  struct sd_image *image = find_sd_image(name);
+  if (image == NULL) {
+    if (sd_image_count >= LOADER_MAX_INFO) return;
+    image = &sd_image_table[sd_image_count++];
+    strcpy(image->name, name);
+  }
+  image->bin = bin;
+  image->size = size;
+}
+
+// Compare the file with a copy in RAM without allocating
+static bool
+same_file(File &f, const uint8_t *bin, uint32_t size)
+{
+  uint8_t buf[64];
+
+  for (uint32_t n = 0; n < size; ) {
+    int len = f.read(buf, size - n > sizeof(buf) ? sizeof(buf) : size - n);
+    if (len <= 0 || memcmp(buf, bin + n, len) != 0) return false;
+    n += len;
+  }
+  return true;
+}
+
+// Read a whole file into the mruby heap, or find the copy kept last time
+static uint8_t *
+read_sd(mrb_state *mrb, const char *name, uint32_t *file_size)
+{
+  if (!loader_sd_begin()) return NULL;
+
+  File f = SD.open(name);
+  if (!f) return NULL;
+
+  uint32_t size = *file_size = f.size();
+  struct sd_image *image = find_sd_image(name);
+  if (image && image->size == size && same_file(f, image->bin, size)) {
+    f.close();
+    return image->bin;
+  }
+
+  uint8_t *bin = NULL;
+  if (f.seek(0)) {
+    bin = (uint8_t *)mrb_malloc_simple(mrb, size);
+  }
+  if (bin) {
+    uint32_t n = 0;
+    while (n < size) {
+      int len = f.read(bin + n, size - n > 0x4000 ? 0x4000 : size - n);
+      if (len <= 0) break;
+      n += len;
+    }
+    if (n < size || !valid_image(bin, size)) {
+      mrb_free(mrb, bin);
+      bin = NULL;
+    }
+  }
+  f.close();
+  return bin;
+}
+
+static bool
+in_image(const void *p, const uint8_t *bin, size_t size)
+{
+  return (const uint8_t *)p >= bin && (const uint8_t *)p < bin + size;
+}
+
+// mrb_read_irep() uses iseq, string literals and new symbol names where
+// they are in the image, everything else is allocated
+static void
+measure(mrb_state *mrb, mrb_irep *irep, struct loader_info *info, const uint8_t *bin)
+{
+  size_t iseq = irep->ilen * sizeof(mrb_code);
+
+  info->ram += sizeof(mrb_irep) + irep->plen * sizeof(mrb_value) +
+               irep->slen * sizeof(mrb_sym) + irep->rlen * sizeof(mrb_irep *);
+  if (irep->lv) {
+    info->ram += (irep->nlocals - 1) * sizeof(struct mrb_locals);
+  }
+  if (in_image(irep->iseq, bin, info->size)) {
+    info->in_place += iseq;
+  } else {
+    info->ram += iseq;
+  }
+  for (size_t i = 0; i < irep->plen; i++) {
+    if (!mrb_string_p(irep->pool[i])) continue;
+    if (in_image(RSTRING_PTR(irep->pool[i]), bin, info->size)) {
+      info->in_place += RSTRING_LEN(irep->pool[i]);
+    } else {
+      info->ram += RSTRING_LEN(irep->pool[i]);
+    }
+  }
+  for (size_t i = 0; i < irep->slen; i++) {
+    mrb_int len;
+    const char *name = irep->syms[i] ? mrb_sym2name_len(mrb, irep->syms[i], &len) : NULL;
+    if (name && in_image(name, bin, info->size)) {
+      info->in_place += len;
+    }
+  }
+  for (size_t i = 0; i < irep->rlen; i++) {
+    measure(mrb, irep->reps[i], info, bin);
+  }
+}
+
+static void
+record(mrb_state *mrb, const char *name, mrb_irep *irep, const uint8_t *bin, bool rom)
+{
+  // a file loaded again replaces its entry
+  struct loader_info *info = NULL;
+  for (int i = 0; i < loader_info_count; i++) {
+    if (strncmp(loader_info_table[i].name, name, sizeof(info->name) - 1) == 0) {
+      info = &loader_info_table[i];
+      break;
+    }
+  }
+  if (info == NULL) {
+    if (loader_info_count >= LOADER_MAX_INFO) return;
+    info = &loader_info_table[loader_info_count++];
+  }
+  const struct rite_binary_header *header = (const struct rite_binary_header *)bin;
+  strncpy(info->name, name, sizeof(info->name) - 1);
+  info->name[sizeof(info->name) - 1] = '\0';
+  info->rom = rom;
+  info->size = bin_to_uint32(header->binary_size);
+  info->ram = 0;
+  info->in_place = 0;
+  measure(mrb, irep, info, bin);
+  if (!rom) {
+    // the image itself is in RAM
+    info->ram += info->size;
+  }
+}
+
+int
+loader_count(void)
+{
+  return loader_info_count;
+}
+
+const struct loader_info *
+loader_get_info(int i)
+{
+  return &loader_info_table[i];
+}
+
+// Returns false if there is no such image. An exception raised while
+// running the image is left in mrb->exc.
+bool
+loader_run(mrb_state *mrb, const char *name)
+{
+  bool rom = true;
+  const uint8_t *bin = find_rom(name);
+  uint8_t *copy = NULL;
+  uint32_t size = 0;
+  if (bin == NULL) {
+    rom = false;
+    bin = copy = read_sd(mrb, name, &size);
+  }
+  if (bin == NULL) {
+    return false;
+  }
+  struct sd_image *image = copy ? find_sd_image(name) : NULL;
+  bool kept = image && image->bin == copy;
+
+  // as mrb_load_irep(), with the irep measured before it runs
+  int ai = mrb_gc_arena_save(mrb);
+  mrb_irep *irep = mrb_read_irep(mrb, bin);
+  if (irep == NULL) {
+    // nothing points into an image that did not load
+    if (copy && !kept) {
+      mrb_free(mrb, copy);
+    }
+    mrb->exc = mrb_obj_ptr(mrb_exc_new_str_lit(mrb, E_SCRIPT_ERROR, "irep load error"));
+  } else {
+    if (copy && !kept) {
+      keep_sd_image(name, copy, size);
+    }
+    record(mrb, name, irep, bin, rom);
+    struct RProc *proc = mrb_proc_new(mrb, irep);
+    mrb_irep_decref(mrb, irep);
+    mrb_top_run(mrb, proc, mrb_top_self(mrb), 0);
+  }
+  mrb_gc_arena_restore(mrb, ai);
+  return true;
+}
+
+static void
+load_or_raise(mrb_state *mrb, const char *name)
+{
+  if (!loader_run(mrb, name)) {
+    mrb_raisef(mrb, E_SCRIPT_ERROR, "cannot load such file -- %S",
+               mrb_str_new_cstr(mrb, name));
+  }
+  if (mrb->exc) {
+    mrb_exc_raise(mrb, mrb_obj_value(mrb->exc));
+  }
+}
+
+static mrb_value
+f_load(mrb_state *mrb, mrb_value self)
+{
+  char *name;
+
+  mrb_get_args(mrb, "z", &name);
+  load_or_raise(mrb, name);
+  return mrb_true_value();
+}
+
+// Like load, but adds ".mrb" and runs each file only once
+static mrb_value
+f_require(mrb_state *mrb, mrb_value self)
+{
+  mrb_value feature;
+
+  mrb_get_args(mrb, "S", &feature);
+  if (RSTRING_LEN(feature) < 4 ||
+      memcmp(RSTRING_END(feature) - 4, ".mrb", 4) != 0) {
+    feature = mrb_str_plus(mrb, feature, mrb_str_new_lit(mrb, ".mrb"));
+  }
+
+  mrb_sym sym = mrb_intern_lit(mrb, "$\"");
+  mrb_value loaded = mrb_gv_get(mrb, sym);
+  if (!mrb_array_p(loaded)) {
+    loaded = mrb_ary_new(mrb);
+    mrb_gv_set(mrb, sym, loaded);
+  }
+  for (mrb_int i = 0; i < RARRAY_LEN(loaded); i++) {
+    if (mrb_str_equal(mrb, mrb_ary_ref(mrb, loaded, i), feature)) {
+      return mrb_false_value();
+    }
+  }
+
+  load_or_raise(mrb, mrb_string_value_cstr(mrb, &feature));
+  mrb_ary_push(mrb, loaded, feature);
+  return mrb_true_value();
+}
+
+void
+setup_loader(mrb_state *mrb)
+{
+  struct RClass *krn = mrb->kernel_module;
+
+  mrb_define_method(mrb, krn, "load", f_load, MRB_ARGS_REQ(1));
+  mrb_define_method(mrb, krn, "require", f_require, MRB_ARGS_REQ(1));
+}
@@ -0,0 +1,42 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct mrb_state;
+
+// A bytecode image linked into ROM. Images are collected in the .mrbrom
+// section and found by name before the SD card is searched.
+struct loader_rom_image {
+  const char *name;
+  const uint8_t *bin;
+};
+
+// Register an array written by `mrbc -B<sym>` under a file name:
+//   LOADER_ROM_IMAGE(hello, "hello.mrb")
+// The makefile does this for every scripts/*.rb. Images in ROM run in
+// place: iseq, string literals and symbol names are not copied to RAM.
+#define LOADER_ROM_IMAGE(sym, file) \
+  static const struct loader_rom_image sym##_rom_image \
+    __attribute__((section(".mrbrom"), used)) = { file, sym }
+
+// What the last loaded images cost in RAM
+#define LOADER_MAX_INFO 8
+
+struct loader_info {
+  char name[16];
+  bool rom;
+  size_t size;        // bytes of the image
+  size_t ram;         // bytes allocated for the loaded code
+  size_t in_place;    // bytes used from the image instead of copied
+};
+
+void setup_loader(struct mrb_state *mrb);
+bool loader_run(struct mrb_state *mrb, const char *name);
+bool loader_sd_begin(void);
+int loader_count(void);
+const struct loader_info *loader_get_info(int i);
+
+#endif
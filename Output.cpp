@@ -0,0 +1,184 @@
+/* Console output buffer drained by the serial port and the display */
+#include "Arduino.h"
+#include "Output.h"
+
+// Only used from the main loop, never from interrupts. The positions run
+// freely and are masked on access, so head - tail is the pending length.
+static uint8_t output_buffer[OUTPUT_BUFFER_SIZE];
+static uint32_t output_head = 0;
+
+static struct {
+  output_sink sink;
+  uint32_t tail;
+  unsigned long drained;
+  bool muted;
+} output_sinks[OUTPUT_MAX_SINKS];
+static int output_sink_count = 0;
+static unsigned long output_written = 0;
+static unsigned long output_waited = 0;
+
+bool
+output_add_sink(output_sink sink)
+{
+  if (output_sink_count >= OUTPUT_MAX_SINKS) {
+    return false;
+  }
+  output_sinks[output_sink_count].sink = sink;
+  output_sinks[output_sink_count].tail = output_head;
+  output_sinks[output_sink_count].drained = 0;
+  output_sinks[output_sink_count].muted = false;
+  output_sink_count++;
+  return true;
+}
+
+// A muted sink skips everything written until it is unmuted
+void
+output_mute(output_sink sink, bool mute)
+{
+  for (int i = 0; i < output_sink_count; i++) {
+    if (output_sinks[i].sink == sink) {
+      output_sinks[i].muted = mute;
+      output_sinks[i].tail = output_head;
+    }
+  }
+}
+
+// Free bytes, limited by the sink that is furthest behind
+static uint32_t
+output_space(void)
+{
+  uint32_t space = OUTPUT_BUFFER_SIZE;
+
+  for (int i = 0; i < output_sink_count; i++) {
+    if (output_sinks[i].muted) continue;
+    uint32_t free = OUTPUT_BUFFER_SIZE - (output_head - output_sinks[i].tail);
+    if (free < space) {
+      space = free;
+    }
+  }
+  return space;
+}
+
+// Offer each sink what it has not taken yet. Returns true while
+// some sink has bytes left.
+bool
+output_task(void)
+{
+  bool pending = false;
+
+  for (int i = 0; i < output_sink_count; i++) {
+    size_t len, n;
+    if (output_sinks[i].muted) {
+      output_sinks[i].tail = output_head;
+      continue;
+    }
+    do {
+      // the bytes may wrap around the end of the buffer
+      uint32_t pos = output_sinks[i].tail & (OUTPUT_BUFFER_SIZE - 1);
+      len = output_head - output_sinks[i].tail;
+      if (len > OUTPUT_BUFFER_SIZE - pos) {
+        len = OUTPUT_BUFFER_SIZE - pos;
+      }
+      n = output_sinks[i].sink(&output_buffer[pos], len);
+      output_sinks[i].tail += n;
+      output_sinks[i].drained += n;
+    } while (n > 0 && n == len && output_sinks[i].tail != output_head);
+
+    if (output_sinks[i].tail != output_head) {
+      pending = true;
+    }
+  }
+  return pending;
+}
+
+void
+output_flush(void)
+{
+  while (output_task()) {
+    ;
+  }
+}
+
+void
+output_stat(struct output_stat *stat)
+{
+  stat->written = output_written;
+  stat->waited = output_waited;
+  stat->sinks = output_sink_count;
+  for (int i = 0; i < output_sink_count; i++) {
+    stat->drained[i] = output_sinks[i].drained;
+  }
+}
+
+void
+output_write(const char *s, size_t len)
+{
+  while (len > 0) {
+    uint32_t space = output_space();
+    if (space == 0) {
+      unsigned long start = millis();
+      do {
+        output_task();
+      } while ((space = output_space()) == 0);
+      output_waited += millis() - start;
+    }
+
+    uint32_t pos = output_head & (OUTPUT_BUFFER_SIZE - 1);
+    uint32_t n = OUTPUT_BUFFER_SIZE - pos;
+    if (n > space) {
+      n = space;
+    }
+    if (n > len) {
+      n = len;
+    }
+    memcpy(&output_buffer[pos], s, n);
+    output_head += n;
+    output_written += n;
+    s += n;
+    len -= n;
+  }
+  output_task();
+}
+
+void
+output_putc(char c)
+{
+  output_write(&c, 1);
+}
+
+void
+output_print(const char *s)
+{
+  output_write(s, strlen(s));
+}
+
+void
+output_print(int i)
+{
+  char buf[12];
+  char *p = buf + sizeof(buf);
+  unsigned int u = i < 0 ? 0U - (unsigned int)i : (unsigned int)i;
+
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u > 0);
+  if (i < 0) {
+    *--p = '-';
+  }
+  output_write(p, buf + sizeof(buf) - p);
+}
+
+void
+output_println(const char *s)
+{
+  output_print(s);
+  output_write("\r\n", 2);
+}
+
+void
+output_println(int i)
+{
+  output_print(i);
+  output_write("\r\n", 2);
+}
@@ -0,0 +1,42 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Console output shared by all sinks. Each sink takes bytes at its own
+// pace, a writer only waits when the slowest sink is a whole buffer behind.
+// Must be a power of two.
+#define OUTPUT_BUFFER_SIZE 2048
+#define OUTPUT_MAX_SINKS   3
+
+// Takes up to len bytes without blocking and returns how many were taken.
+// Also called with len == 0, so a sink can finish deferred work.
+typedef size_t (*output_sink)(const uint8_t *buf, size_t len);
+
+struct output_stat {
+  unsigned long written;                    // bytes put into the buffer
+  unsigned long waited;                     // ms writers waited for a sink
+  int sinks;                                // number of sinks
+  unsigned long drained[OUTPUT_MAX_SINKS];  // bytes taken by each sink
+};
+
+bool output_add_sink(output_sink sink);
+void output_mute(output_sink sink, bool mute);
+void output_write(const char *s, size_t len);
+void output_putc(char c);
+void output_print(const char *s);
+void output_print(int i);
+void output_println(const char *s);
+void output_println(int i);
+bool output_task(void);
+void output_flush(void);
+void output_stat(struct output_stat *stat);
+
+/* use the output buffer instead of stdout */
+#define stdout_putc(c)           { output_putc(c); }
+#define stdout_write(s, len)     { output_write(s, len); }
+#define stdout_print(s)          { output_print(s); }
+#define stdout_println(s)        { output_println(s); }
+
+#endif
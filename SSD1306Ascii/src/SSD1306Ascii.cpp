@@ -59,6 +59,48 @@ void SSD1306Ascii::clearToEOL() {
   clear (m_col, displayWidth() - 1, m_row, m_row + fontRows() - 1);
 }
 //------------------------------------------------------------------------------
+#if INCLUDE_FRAMEBUFFER
+void SSD1306Ascii::flushDisplay() {
+  if (!m_frameEnabled) return;
+  if (m_startLinePending) {
+    m_startLinePending = false;
+    // Share the transfer of the first span if there is one.
+    uint8_t mode = SSD1306_MODE_CMD;
+    for (uint8_t r = 0; r < displayRows(); r++) {
+      if (m_dirtyFirst[r] <= m_dirtyLast[r]) {
+        mode = SSD1306_MODE_CMD_BUF;
+        break;
+      }
+    }
+    writeDisplay(SSD1306_SETSTARTLINE | m_startLine, mode);
+  }
+  for (uint8_t r = 0; r < displayRows(); r++) {
+    uint8_t c0 = m_dirtyFirst[r];
+    uint8_t c1 = m_dirtyLast[r];
+    if (c0 > c1) continue;
+    m_dirtyFirst[r] = 0XFF;
+    m_dirtyLast[r] = 0;
+    uint8_t col = c0 + m_colOffset;
+    // The span always follows so the cursor may share its transfer.
+    writeDisplay(SSD1306_SETSTARTPAGE | r, SSD1306_MODE_CMD_BUF);
+    writeDisplay(SSD1306_SETLOWCOLUMN | (col & 0XF), SSD1306_MODE_CMD_BUF);
+    writeDisplay(SSD1306_SETHIGHCOLUMN | (col >> 4), SSD1306_MODE_CMD_BUF);
+    for (uint8_t c = c0; c < c1; c++) {
+      writeDisplay(m_frame[r][c], SSD1306_MODE_RAM_BUF);
+    }
+    // Unbuffered mode ends the burst.
+    writeDisplay(m_frame[r][c1], SSD1306_MODE_RAM);
+  }
+}
+//------------------------------------------------------------------------------
+void SSD1306Ascii::frameWrite(uint8_t c) {
+  if (m_frame[m_row][m_col] == c) return;
+  m_frame[m_row][m_col] = c;
+  if (m_col < m_dirtyFirst[m_row]) m_dirtyFirst[m_row] = m_col;
+  if (m_col > m_dirtyLast[m_row]) m_dirtyLast[m_row] = m_col;
+}
+#endif  // INCLUDE_FRAMEBUFFER
+//------------------------------------------------------------------------------
 uint8_t SSD1306Ascii::fontHeight() {
   return m_font ? m_magFactor*readFontByte(m_font + FONT_HEIGHT) : 0;
 }
@@ -99,6 +141,10 @@ void SSD1306Ascii::reset(uint8_t rst) {
 void SSD1306Ascii::setCol(uint8_t col) {
   if (col >= m_displayWidth) return;
   m_col = col;
+#if INCLUDE_FRAMEBUFFER
+  // The cursor is sent with each span by flushDisplay().
+  if (m_frameEnabled) return;
+#endif  // INCLUDE_FRAMEBUFFER
   col += m_colOffset;
   ssd1306WriteCmd(SSD1306_SETLOWCOLUMN | (col & 0XF));
   ssd1306WriteCmd(SSD1306_SETHIGHCOLUMN | (col >> 4));    
@@ -114,12 +160,65 @@ void SSD1306Ascii::setCursor(uint8_t col, uint8_t row) {
   setRow(row);
 }  
 //------------------------------------------------------------------------------
+void SSD1306Ascii::setFont(const uint8_t* font) {
+  m_font = font;
+#if INCLUDE_GLYPH_TABLE
+  m_glyphCount = 0;
+  if (!font || (readFontByte(font) == 0 && readFontByte(font + 1) < 2)) {
+    return;
+  }
+  uint8_t count = readFontByte(font + FONT_CHAR_COUNT);
+  uint16_t index = 0;
+  uint8_t i;
+  for (i = 0; i < count && i < SSD1306_GLYPH_TABLE_SIZE; i++) {
+    m_glyphIndex[i] = index;
+    index += readFontByte(font + FONT_WIDTH_TABLE + i);
+  }
+  m_glyphCount = i;
+#endif  // INCLUDE_GLYPH_TABLE
+}
+//------------------------------------------------------------------------------
+#if INCLUDE_FRAMEBUFFER
+void SSD1306Ascii::setFramebuffer(bool enable) {
+  if (!enable) {
+    flushDisplay();
+    m_frameEnabled = false;
+    setCursor(m_col, m_row);
+    return;
+  }
+  if (m_displayWidth > SSD1306_FRAME_WIDTH ||
+      m_displayHeight > 8*SSD1306_FRAME_ROWS) {
+    return;
+  }
+  // Controller RAM contents are unknown so mark every column changed.
+  memset(m_frame, 0, sizeof(m_frame));
+  memset(m_dirtyFirst, 0, sizeof(m_dirtyFirst));
+  memset(m_dirtyLast, m_displayWidth - 1, sizeof(m_dirtyLast));
+  m_frameEnabled = true;
+  clear();
+}
+#endif  // INCLUDE_FRAMEBUFFER
+//------------------------------------------------------------------------------
 void SSD1306Ascii::setRow(uint8_t row) {
   if (row >= m_displayHeight/8) return;
   m_row = row;
+#if INCLUDE_FRAMEBUFFER
+  if (m_frameEnabled) return;
+#endif  // INCLUDE_FRAMEBUFFER
   ssd1306WriteCmd(SSD1306_SETSTARTPAGE | row); 
 }
 //------------------------------------------------------------------------------
+void SSD1306Ascii::setStartLine(uint8_t line) {
+#if INCLUDE_FRAMEBUFFER
+  if (m_frameEnabled) {
+    m_startLine = line & 0X3F;
+    m_startLinePending = true;
+    return;
+  }
+#endif  // INCLUDE_FRAMEBUFFER
+  ssd1306WriteCmd(SSD1306_SETSTARTLINE | (line & 0X3F));
+}
+//------------------------------------------------------------------------------
 #if INCLUDE_SCROLLING 
 void SSD1306Ascii::setScroll(bool enable) {
   if (m_displayHeight != 64) return;
@@ -128,14 +227,35 @@ void SSD1306Ascii::setScroll(bool enable) {
 }
 #endif   // INCLUDE_SCROLLING 
 //-----------------------------------------------------------------------------
+void SSD1306Ascii::ssd1306WriteCmd(uint8_t c) {
+#if INCLUDE_FRAMEBUFFER
+  flushDisplay();
+#endif  // INCLUDE_FRAMEBUFFER
+  writeDisplay(c, SSD1306_MODE_CMD);
+}
+//-----------------------------------------------------------------------------
 void SSD1306Ascii::ssd1306WriteRam(uint8_t c) {
   if (m_col >= m_displayWidth) return;
+#if INCLUDE_FRAMEBUFFER
+  if (m_frameEnabled) {
+    frameWrite(c);
+    m_col++;
+    return;
+  }
+#endif  // INCLUDE_FRAMEBUFFER
   writeDisplay(c, SSD1306_MODE_RAM);
   m_col++;
 }
 //-----------------------------------------------------------------------------
 void SSD1306Ascii::ssd1306WriteRamBuf(uint8_t c) {
   if (m_col >= m_displayWidth) return;
+#if INCLUDE_FRAMEBUFFER
+  if (m_frameEnabled) {
+    frameWrite(c);
+    m_col++;
+    return;
+  }
+#endif  // INCLUDE_FRAMEBUFFER
   writeDisplay(c, SSD1306_MODE_RAM_BUF);
   m_col++;
 }
@@ -147,6 +267,37 @@ GLCDFONTDECL(scaledNibble) = {
   0XF0, 0XF3, 0XFC, 0XFF
 };
 //------------------------------------------------------------------------------
+#if INCLUDE_GLYPH_CACHE
+const uint8_t* SSD1306Ascii::cacheGlyph(uint8_t ch, const uint8_t* base,
+                                        uint8_t w, uint8_t nr, uint8_t shift) {
+  if (2*nr*w > SSD1306_GLYPH_CACHE_BYTES) return 0;
+  for (uint8_t i = 0; i < SSD1306_GLYPH_CACHE_ENTRIES; i++) {
+    if (m_cache[i].font == m_font && m_cache[i].ch == ch) {
+      return m_cache[i].data;
+    }
+  }
+  GlyphCache* g = &m_cache[m_cacheNext];
+  if (++m_cacheNext >= SSD1306_GLYPH_CACHE_ENTRIES) m_cacheNext = 0;
+  g->font = m_font;
+  g->ch = ch;
+  // Store in the order write() sends to the display.
+  uint8_t* p = g->data;
+  for (uint8_t r = 0; r < nr; r++) {
+    for (uint8_t m = 0; m < 2; m++) {
+      for (uint8_t c = 0; c < w; c++) {
+        uint8_t b = readFontByte(base + c + r*w);
+        if (shift && (r + 1) == nr) {
+          b >>= shift;
+        }
+        b = m ?  b >> 4 : b & 0XF;
+        *p++ = readFontByte(scaledNibble + b);
+      }
+    }
+  }
+  return g->data;
+}
+#endif  // INCLUDE_GLYPH_CACHE
+//------------------------------------------------------------------------------
 size_t SSD1306Ascii::write(uint8_t ch) {
   const uint8_t* base = m_font;
   if (!base) return 0;
@@ -197,7 +348,14 @@ size_t SSD1306Ascii::write(uint8_t ch) {
       thieleShift = 8 - (h & 7);
     }
     uint16_t index = 0;
-    for (uint8_t i = 0; i < ch; i++) {
+    uint8_t i = 0;
+#if INCLUDE_GLYPH_TABLE
+    if (m_glyphCount) {
+      i = ch < m_glyphCount ? ch : m_glyphCount - 1;
+      index = m_glyphIndex[i];
+    }
+#endif  // INCLUDE_GLYPH_TABLE
+    for (; i < ch; i++) {
       index += readFontByte(base + i);
     }
     w = readFontByte(base + ch);
@@ -205,10 +363,23 @@ size_t SSD1306Ascii::write(uint8_t ch) {
   }
   uint8_t scol = m_col;
   uint8_t srow = m_row;
+#if INCLUDE_GLYPH_CACHE
+  const uint8_t* cache = 0;
+  if (m_magFactor == 2) {
+    cache = cacheGlyph(ch, base, w, nr, thieleShift);
+  }
+#endif  // INCLUDE_GLYPH_CACHE
   for (uint8_t r = 0; r < nr; r++) {
     for (uint8_t m = 0; m < m_magFactor; m++) {
       if (r || m) setCursor(scol, m_row + 1);
       for (uint8_t c = 0; c < w; c++) {
+#if INCLUDE_GLYPH_CACHE
+        if (cache) {
+          ssd1306WriteRamBuf(*cache);
+          ssd1306WriteRamBuf(*cache++);
+          continue;
+        }
+#endif  // INCLUDE_GLYPH_CACHE
         uint8_t b = readFontByte(base + c + r*w);
         if (thieleShift && (r + 1) == nr) {
           b >>= thieleShift;
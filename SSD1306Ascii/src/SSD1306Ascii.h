@@ -47,6 +47,54 @@
  */
 #define INCLUDE_SCROLLING 1
 
+/** Include a RAM shadow of the display controller memory.
+ *
+ * If INCLUDE_FRAMEBUFFER is defined to be zero, the frame buffer code
+ * and its 1 KB of RAM will not be included.
+ *
+ * If INCLUDE_FRAMEBUFFER is defined to be one, the frame buffer will be
+ * included but not enabled.  A call to setFramebuffer() will be required
+ * to enable it.  While enabled, characters are rendered into RAM and only
+ * the changed span of each row is sent to the controller by flushDisplay().
+ */
+#define INCLUDE_FRAMEBUFFER 1
+
+/** Frame buffer width in pixels, the largest supported display width. */
+#define SSD1306_FRAME_WIDTH 128
+
+/** Frame buffer height in eight pixel rows. */
+#define SSD1306_FRAME_ROWS 8
+
+/** Build a table of glyph offsets for proportional fonts in setFont().
+ *
+ * If INCLUDE_GLYPH_TABLE is defined to be one, write() finds a glyph
+ * without summing the width table.  Uses 2*SSD1306_GLYPH_TABLE_SIZE
+ * bytes of RAM.  Characters past the end of the table are found by
+ * summing from the last entry.
+ */
+#ifndef INCLUDE_GLYPH_TABLE
+#define INCLUDE_GLYPH_TABLE 1
+#endif  // INCLUDE_GLYPH_TABLE
+
+/** Number of entries in the glyph offset table. */
+#define SSD1306_GLYPH_TABLE_SIZE 128
+
+/** Cache magnified glyphs.
+ *
+ * If INCLUDE_GLYPH_CACHE is defined to be one, set2X() characters are
+ * expanded once and kept in a small round robin cache.  Uses about
+ * SSD1306_GLYPH_CACHE_ENTRIES*(SSD1306_GLYPH_CACHE_BYTES + 6) bytes of RAM.
+ */
+#ifndef INCLUDE_GLYPH_CACHE
+#define INCLUDE_GLYPH_CACHE 0
+#endif  // INCLUDE_GLYPH_CACHE
+
+/** Number of glyphs in the cache. */
+#define SSD1306_GLYPH_CACHE_ENTRIES 8
+
+/** Largest expanded glyph that will be cached, in bytes. */
+#define SSD1306_GLYPH_CACHE_BYTES 64
+
 /** Use larger faster I2C code. */
 #define OPTIMIZE_I2C 1
 
@@ -62,6 +110,10 @@
 #define SSD1306_MODE_RAM     1
 /** Write to display RAM with possible buffering. */
 #define SSD1306_MODE_RAM_BUF 2
+/** Write to Command register with possible buffering.
+ *  Must be followed by a write to display RAM.
+ */
+#define SSD1306_MODE_CMD_BUF 3
 //------------------------------------------------------------------------------
 /**
  * @class SSD1306Ascii
@@ -69,7 +121,21 @@
  */
 class SSD1306Ascii : public Print {
  public:
-  SSD1306Ascii() : m_magFactor(1), m_font(0) {}
+  SSD1306Ascii() : m_magFactor(1), m_font(0) {
+#if INCLUDE_GLYPH_TABLE
+    m_glyphCount = 0;
+#endif  // INCLUDE_GLYPH_TABLE
+#if INCLUDE_GLYPH_CACHE
+    m_cacheNext = 0;
+    for (uint8_t i = 0; i < SSD1306_GLYPH_CACHE_ENTRIES; i++) {
+      m_cache[i].font = 0;
+    }
+#endif  // INCLUDE_GLYPH_CACHE
+#if INCLUDE_FRAMEBUFFER
+    m_frameEnabled = false;
+    m_startLinePending = false;
+#endif  // INCLUDE_FRAMEBUFFER
+  }
   /**
    * @brief Determine the width of a character.
    *
@@ -114,6 +180,15 @@ class SSD1306Ascii : public Print {
    * @return The display width in pixels.
    */
   uint8_t displayWidth() {return m_displayWidth;}
+#if INCLUDE_FRAMEBUFFER
+  /**
+   * @brief Send changed frame buffer spans to the display controller.
+   *
+   * @note Each row with changes costs one cursor command sequence and
+   *       one burst of data.  Does nothing if the frame buffer is disabled.
+   */
+  void flushDisplay();
+#endif  // INCLUDE_FRAMEBUFFER
   /**
    * @return The current font height in pixels.
    */
@@ -183,13 +258,32 @@ class SSD1306Ascii : public Print {
    *
    * @param[in] font Pointer to a font table.
    */
-  void setFont(const uint8_t* font) {m_font = font;}
+  void setFont(const uint8_t* font);
+#if INCLUDE_FRAMEBUFFER
+  /**
+   * @brief Enable or disable the frame buffer.
+   *
+   * @param[in] enable true render into RAM, false write directly to
+   *            the controller.
+   * @note Enabling the frame buffer clears the display.  Output is not
+   *       visible until flushDisplay() or a command byte is sent.
+   */
+  void setFramebuffer(bool enable);
+#endif  // INCLUDE_FRAMEBUFFER
   /**
    * @brief Set the current row number.
    *
    * @param[in] row the row number in eight pixel rows.
    */
   void setRow(uint8_t row);
+  /**
+   * @brief Set the RAM line shown at the top of the display.
+   *
+   * @param[in] line the line number in pixels, 0 to 63.
+   * @note With the frame buffer enabled the command is held and sent
+   *       at the start of the next flushDisplay(), with the changed spans.
+   */
+  void setStartLine(uint8_t line);
 #if INCLUDE_SCROLLING   
   /**
    * @brief Enable or disable scroll mode.
@@ -206,9 +300,10 @@ class SSD1306Ascii : public Print {
    * @brief Write a command byte to the display controller.
    *
    * @param[in] c The command byte.
-   * @note The byte will immediately be sent to the controller. 
+   * @note The byte will immediately be sent to the controller.
+   *       Pending frame buffer changes are flushed first.
    */
-  void ssd1306WriteCmd(uint8_t c) {writeDisplay(c, SSD1306_MODE_CMD);}
+  void ssd1306WriteCmd(uint8_t c);
   /**
    * @brief Write a byte to RAM in the display controller.
    *
@@ -251,5 +346,29 @@ class SSD1306Ascii : public Print {
   uint8_t m_scroll;          // Scroll mode 
 #endif  // INCLUDE_SCROLLING    
   const uint8_t* m_font;    // Current font.
+#if INCLUDE_GLYPH_TABLE
+  uint8_t m_glyphCount;     // Valid entries in m_glyphIndex.
+  uint16_t m_glyphIndex[SSD1306_GLYPH_TABLE_SIZE];  // Sum of prior widths.
+#endif  // INCLUDE_GLYPH_TABLE
+#if INCLUDE_GLYPH_CACHE
+  struct GlyphCache {
+    const uint8_t* font;
+    uint8_t ch;
+    uint8_t data[SSD1306_GLYPH_CACHE_BYTES];
+  };
+  const uint8_t* cacheGlyph(uint8_t ch, const uint8_t* base,
+                            uint8_t w, uint8_t nr, uint8_t shift);
+  uint8_t m_cacheNext;      // Next entry to replace.
+  GlyphCache m_cache[SSD1306_GLYPH_CACHE_ENTRIES];
+#endif  // INCLUDE_GLYPH_CACHE
+#if INCLUDE_FRAMEBUFFER
+  void frameWrite(uint8_t c);
+  bool m_frameEnabled;      // Render into m_frame.
+  bool m_startLinePending;  // m_startLine not sent yet.
+  uint8_t m_startLine;      // Display start line for flushDisplay().
+  uint8_t m_dirtyFirst[SSD1306_FRAME_ROWS];  // First changed column in row.
+  uint8_t m_dirtyLast[SSD1306_FRAME_ROWS];   // Last changed column in row.
+  uint8_t m_frame[SSD1306_FRAME_ROWS][SSD1306_FRAME_WIDTH];  // RAM shadow.
+#endif  // INCLUDE_FRAMEBUFFER
 };
 #endif  // SSD1306Ascii_h
@@ -51,6 +51,7 @@ class SSD1306AsciiAvrI2c : public SSD1306Ascii {
 
  protected:
   void writeDisplay(uint8_t b, uint8_t mode) {
+    if (mode == SSD1306_MODE_CMD_BUF) mode = SSD1306_MODE_CMD;
     if ((m_nData && mode == SSD1306_MODE_CMD)) {
       m_i2c.stop();
       m_nData = 0;
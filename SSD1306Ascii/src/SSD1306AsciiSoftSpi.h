@@ -68,7 +68,7 @@ class SSD1306AsciiSoftSpi : public SSD1306Ascii {
   }
  protected:
   void writeDisplay(uint8_t b, uint8_t mode) {
-    m_dcPin.write(mode != SSD1306_MODE_CMD);
+    m_dcPin.write(mode == SSD1306_MODE_RAM || mode == SSD1306_MODE_RAM_BUF);
     m_csPin.write(LOW);
     for (uint8_t m = 0X80; m; m >>= 1) {
       m_clkPin.write(LOW);
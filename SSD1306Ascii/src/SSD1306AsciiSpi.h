@@ -64,7 +64,7 @@ class SSD1306AsciiSpi : public SSD1306Ascii {
   
  protected:
   void writeDisplay(uint8_t b, uint8_t mode) {
-    digitalWrite(m_dc, mode != SSD1306_MODE_CMD);
+    digitalWrite(m_dc, mode == SSD1306_MODE_RAM || mode == SSD1306_MODE_RAM_BUF);
     SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
     digitalWrite(m_cs, LOW);
     SPI.transfer(b);
@@ -122,7 +122,7 @@ class SSD1306AsciiSpi : public SSD1306Ascii {
  protected:
   //----------------------------------------------------------------------------
   void writeDisplay(uint8_t b, uint8_t mode) {
-    m_dcPin.write(mode != SSD1306_MODE_CMD);
+    m_dcPin.write(mode == SSD1306_MODE_RAM || mode == SSD1306_MODE_RAM_BUF);
     // 8 MHz, SPI_MODE0, MSBFIRST
     SPCR = (1 << SPE) | (1 << MSTR);
     SPSR = 1 << SPI2X;
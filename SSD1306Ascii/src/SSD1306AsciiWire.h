@@ -25,6 +25,23 @@
 #define SSD1306AsciiWire_h
 #include <Wire.h>
 #include "SSD1306Ascii.h"
+//------------------------------------------------------------------------------
+/** Fastest I2C clock begin() will try: 100000, 400000 or 1000000 Hz.
+ *
+ * begin() steps down from this clock until the display acknowledges a
+ * burst of commands.  Define it as 100000 to keep the default clock.
+ */
+#ifndef SSD1306_I2C_MAX_CLOCK
+#define SSD1306_I2C_MAX_CLOCK 400000
+#endif  // SSD1306_I2C_MAX_CLOCK
+/** Largest I2C transfer, control bytes included. */
+#ifdef WIRE_TX_BUFFER_LENGTH
+#define SSD1306_I2C_BUFFER_LENGTH WIRE_TX_BUFFER_LENGTH
+#else  // WIRE_TX_BUFFER_LENGTH
+#define SSD1306_I2C_BUFFER_LENGTH BUFFER_LENGTH
+#endif  // WIRE_TX_BUFFER_LENGTH
+/** Number of NOP commands in one probe burst. */
+#define SSD1306_I2C_PROBE_BYTES 16
 /**
  * @class SSD1306AsciiWire
  * @brief Class for I2C displays using Wire.
@@ -40,10 +57,115 @@ class SSD1306AsciiWire : public SSD1306Ascii {
   void begin(const DevType* dev, uint8_t i2cAddr) {
 #if OPTIMIZE_I2C
     m_nData = 0;
+    m_nSend = 0;
 #endif  // OPTMIZE_I2C
+    resetCounters();
     m_i2cAddr = i2cAddr;
+    m_clock = 100000;
+#if SSD1306_I2C_MAX_CLOCK > 100000
+    selectClock(SSD1306_I2C_MAX_CLOCK);
+#endif  // SSD1306_I2C_MAX_CLOCK
     init(dev);    
   }
+  /**
+   * @return The I2C clock rate in Hz.
+   */
+  uint32_t clock() {return m_clock;}
+  /**
+   * @return Number of bytes sent since resetCounters(), including
+   *         control bytes but not address bytes.
+   */
+  uint32_t byteCount() {return m_nByte;}
+  /**
+   * @return Number of I2C transfers since resetCounters().
+   */
+  uint32_t transferCount() {return m_nTransfer;}
+  /**
+   * @brief Clear the transfer and byte counters.
+   *
+   * Call before flushDisplay() to measure the cost of one flush.
+   */
+  void resetCounters() {
+    m_nTransfer = 0;
+    m_nByte = 0;
+  }
+  /**
+   * @brief Check that the display acknowledges commands at the current clock.
+   *
+   * @return true if every byte of a burst of NOP commands was acknowledged.
+   */
+  bool probe() {
+    for (uint8_t n = 0; n < 4; n++) {
+      Wire.beginTransmission(m_i2cAddr);
+      Wire.write(0X00);
+      for (uint8_t i = 0; i < SSD1306_I2C_PROBE_BYTES; i++) {
+        Wire.write(SSD1306_NOP);
+      }
+      if (Wire.endTransmission() != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+  /**
+   * @brief Select the fastest clock the display acknowledges.
+   *
+   * @param[in] maxFreq The fastest clock to try in Hz.
+   * @return The selected clock in Hz.  If no clock is acknowledged the
+   *         clock is left at 100 kHz.
+   */
+  uint32_t selectClock(uint32_t maxFreq) {
+    static const uint32_t clocks[] = {1000000, 400000, 100000};
+    for (uint8_t i = 0; i < sizeof(clocks)/sizeof(clocks[0]); i++) {
+      if (clocks[i] > maxFreq) continue;
+      setClock(clocks[i]);
+      if (probe()) return m_clock;
+    }
+    setClock(100000);
+    return m_clock;
+  }
+  /**
+   * @brief Set the I2C clock rate.
+   *
+   * @param[in] freq The clock rate in Hz.
+   */
+  void setClock(uint32_t freq) {
+#ifdef GRSAKURA
+    Wire.setFrequency(freq);
+    m_clock = freq;
+#else  // GRSAKURA
+    if (freq >= 400000) {
+      set400kHz();
+      m_clock = 400000;
+    }
+#endif  // GRSAKURA
+  }
+  /**
+   * @brief Bus timing self-test.
+   *
+   * Sends bursts of NOP commands and times them.
+   *
+   * @return The achieved throughput in bytes per second, including the
+   *         address and control bytes.
+   */
+  uint32_t throughput() {
+#if OPTIMIZE_I2C
+    endTransfer();
+#endif  // OPTIMIZE_I2C
+    const uint8_t nBurst = 8;
+    uint32_t m = micros();
+    for (uint8_t n = 0; n < nBurst; n++) {
+      Wire.beginTransmission(m_i2cAddr);
+      Wire.write(0X00);
+      for (uint8_t i = 0; i < SSD1306_I2C_PROBE_BYTES; i++) {
+        Wire.write(SSD1306_NOP);
+      }
+      Wire.endTransmission();
+    }
+    m = micros() - m;
+    uint32_t bytes = nBurst*(SSD1306_I2C_PROBE_BYTES + 2UL);
+    return m ? bytes*1000000UL/m : 0;
+  }
   /**
    * @brief Set the I2C clock rate to 400 kHz.
    */
@@ -57,6 +179,8 @@ class SSD1306AsciiWire : public SSD1306Ascii {
     // Force 400 KHz I2C, rawr! (Uses pins 20, 21 for SDA, SCL)
     TWI1->TWI_CWGR = 0;
     TWI1->TWI_CWGR = ((VARIANT_MCK / (2 * 400000)) - 4) * 0x101;
+#elif defined(GRSAKURA)
+    setClock(400000);
 #else  // __AVR_  
 #warning set400kHz() disabled for this CPU.
 #endif  // __AVR_    
@@ -65,32 +189,70 @@ class SSD1306AsciiWire : public SSD1306Ascii {
  protected:
   void writeDisplay(uint8_t b, uint8_t mode) {
 #if OPTIMIZE_I2C
-    if (m_nData > 16 || (m_nData && mode == SSD1306_MODE_CMD)) {
-      Wire.endTransmission();
-      m_nData = 0;
+    // A data stream must be the last part of a transfer.
+    if (m_nData && (mode == SSD1306_MODE_CMD || mode == SSD1306_MODE_CMD_BUF
+        || m_nSend + 1 > SSD1306_I2C_BUFFER_LENGTH)) {
+      endTransfer();
+    }
+    if (mode == SSD1306_MODE_CMD || mode == SSD1306_MODE_CMD_BUF) {
+      if (m_nSend + 2 > SSD1306_I2C_BUFFER_LENGTH) {
+        endTransfer();
+      }
+      if (m_nSend == 0) {
+        Wire.beginTransmission(m_i2cAddr);
+      }
+      // Co = 1, another control byte follows the command.
+      Wire.write(0X80);
+      Wire.write(b);
+      m_nSend += 2;
+      if (mode == SSD1306_MODE_CMD) {
+        endTransfer();
+      }
+      return;
     }
     if (m_nData == 0) {
-      Wire.beginTransmission(m_i2cAddr);
-      Wire.write(mode == SSD1306_MODE_CMD ? 0X00 : 0X40);
+      if (m_nSend + 2 > SSD1306_I2C_BUFFER_LENGTH) {
+        endTransfer();
+      }
+      if (m_nSend == 0) {
+        Wire.beginTransmission(m_i2cAddr);
+      }
+      Wire.write(0X40);
+      m_nSend++;
     }
     Wire.write(b);
-    if (mode == SSD1306_MODE_RAM_BUF) {
-      m_nData++; 
-    }else {      
-      Wire.endTransmission();
-      m_nData = 0;
+    m_nSend++;
+    m_nData++;
+    if (mode == SSD1306_MODE_RAM) {
+      endTransfer();
     }
 #else  // OPTIMIZE_I2C    
     Wire.beginTransmission(m_i2cAddr);
-    Wire.write(mode == SSD1306_MODE_CMD ? 0X00: 0X40);
+    Wire.write(mode == SSD1306_MODE_RAM || mode == SSD1306_MODE_RAM_BUF ? 0X40: 0X00);
     Wire.write(b);
     Wire.endTransmission();
+    m_nTransfer++;
+    m_nByte += 2;
 #endif    // OPTIMIZE_I2C
   }
  private:
+#if OPTIMIZE_I2C
+  void endTransfer() {
+    if (m_nSend == 0) return;
+    Wire.endTransmission();
+    m_nTransfer++;
+    m_nByte += m_nSend;
+    m_nSend = 0;
+    m_nData = 0;
+  }
+#endif  // OPTIMIZE_I2C
   uint8_t m_i2cAddr;
+  uint32_t m_clock;
+  uint32_t m_nTransfer;
+  uint32_t m_nByte;
 #if OPTIMIZE_I2C
   uint8_t m_nData;
+  uint8_t m_nSend;
 #endif  // OPTIMIZE_I2C
 };
 #endif  // SSD1306AsciiWire_h
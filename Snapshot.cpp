@@ -0,0 +1,147 @@
+/* Interpreter snapshot on the SD card, restored after system_reboot() */
+#include "Arduino.h"
+#include <SD.h>
+#include "rx63n/iodefine.h"
+
+#include "Heap.h"
+#include "Loader.h"
+#include "Snapshot.h"
+
+// Defined in linker_arduino.gsi
+extern "C" char mrb_heap_start[];
+
+// A snapshot is only good for the build that wrote it. This file is
+// compiled again for every build, so its time stamp tells builds apart.
+struct snapshot_header {
+  char magic[4];
+  char build[24];
+  uint32_t heap;      // address of the heap
+  uint32_t roots;     // bytes of the caller's variables
+};
+
+static File snapshot_file;
+static uint32_t snapshot_sum;
+
+static void
+make_header(struct snapshot_header *header, size_t roots)
+{
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, "MRBS", sizeof(header->magic));
+  strncpy(header->build, __DATE__ " " __TIME__, sizeof(header->build));
+  header->heap = (uint32_t)mrb_heap_start;
+  header->roots = roots;
+}
+
+static void
+checksum(const void *buf, size_t size)
+{
+  const uint8_t *p = (const uint8_t *)buf;
+  for (size_t i = 0; i < size; i++) {
+    snapshot_sum = (snapshot_sum << 5) + snapshot_sum + p[i];
+  }
+}
+
+// SdFile reads and writes at most 32767 bytes at a time
+#define CHUNK 0x4000
+
+static bool
+write_bytes(const void *buf, size_t size)
+{
+  const uint8_t *p = (const uint8_t *)buf;
+  checksum(buf, size);
+  for (size_t n = 0; n < size; n += CHUNK) {
+    size_t len = size - n > CHUNK ? CHUNK : size - n;
+    if (snapshot_file.write(p + n, len) != len) return false;
+  }
+  return true;
+}
+
+static bool
+read_bytes(void *buf, size_t size)
+{
+  uint8_t *p = (uint8_t *)buf;
+  size_t n = 0;
+  while (n < size) {
+    int len = snapshot_file.read(p + n, size - n > CHUNK ? CHUNK : size - n);
+    if (len <= 0) return false;
+    n += len;
+  }
+  checksum(buf, size);
+  return true;
+}
+
+// True once after a software reset. The flag is cleared for the next boot.
+bool
+snapshot_warm_boot(void)
+{
+  bool warm = SYSTEM.RSTSR2.BIT.SWRF;
+  if (warm) {
+    SYSTEM.RSTSR2.BIT.SWRF = 0;
+  }
+  return warm;
+}
+
+// Write the heap and the caller's variables that point into it, unless
+// the card already holds a snapshot of this build
+bool
+snapshot_save(const void *roots, size_t size)
+{
+  struct snapshot_header header, current;
+
+  if (!loader_sd_begin()) return false;
+  make_header(&header, size);
+
+  File f = SD.open(SNAPSHOT_FILE);
+  if (f) {
+    bool same = f.read(&current, sizeof(current)) == (int)sizeof(current) &&
+                memcmp(&current, &header, sizeof(header)) == 0;
+    f.close();
+    if (same) return true;
+    SD.remove(SNAPSHOT_FILE);
+  }
+
+  snapshot_file = SD.open(SNAPSHOT_FILE, FILE_WRITE);
+  if (!snapshot_file) return false;
+  snapshot_sum = 0;
+  bool ok = write_bytes(&header, sizeof(header)) &&
+            write_bytes(roots, size) &&
+            heap_save(write_bytes);
+  uint32_t sum = snapshot_sum;
+  ok = ok && write_bytes(&sum, sizeof(sum));
+  snapshot_file.close();
+  if (!ok) {
+    SD.remove(SNAPSHOT_FILE);
+  }
+  return ok;
+}
+
+// Bring back the heap and the caller's variables. On failure the heap is
+// empty again and a snapshot that does not fit this build is removed.
+bool
+snapshot_restore(void *roots, size_t size)
+{
+  struct snapshot_header header, current;
+
+  if (!loader_sd_begin()) return false;
+  snapshot_file = SD.open(SNAPSHOT_FILE);
+  if (!snapshot_file) return false;
+
+  make_header(&header, size);
+  snapshot_sum = 0;
+  bool ok = read_bytes(&current, sizeof(current)) &&
+            memcmp(&current, &header, sizeof(header)) == 0 &&
+            read_bytes(roots, size) &&
+            heap_restore(read_bytes);
+  if (ok) {
+    uint32_t expected = snapshot_sum;
+    uint32_t sum;
+    ok = read_bytes(&sum, sizeof(sum)) && sum == expected;
+  }
+  snapshot_file.close();
+
+  if (!ok) {
+    SD.remove(SNAPSHOT_FILE);
+    setup_heap();
+  }
+  return ok;
+}
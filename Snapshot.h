@@ -0,0 +1,13 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+
+// File on the SD card that holds the interpreter after setup()
+#define SNAPSHOT_FILE "SNAPSHOT.BIN"
+
+bool snapshot_warm_boot(void);
+bool snapshot_save(const void *roots, size_t size);
+bool snapshot_restore(void *roots, size_t size);
+
+#endif
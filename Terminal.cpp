@@ -0,0 +1,269 @@
+/* Text terminal with VT100 subset for SSD1306Ascii */
+#include "Terminal.h"
+
+enum {
+  STATE_NORMAL,
+  STATE_ESC,
+  STATE_CSI,
+  STATE_IGNORE    // private CSI sequence, skip to the final byte
+};
+
+void
+Terminal::begin(SSD1306Ascii *oled)
+{
+  m_oled = oled;
+  m_cellWidth = oled->fontWidth() + oled->magFactor();
+  m_fontRows = oled->fontRows();
+  m_cols = oled->displayWidth() / m_cellWidth;
+  if (m_cols > TERMINAL_MAX_COLS) m_cols = TERMINAL_MAX_COLS;
+  m_rows = oled->displayRows() / m_fontRows;
+  if (m_rows > TERMINAL_MAX_ROWS) m_rows = TERMINAL_MAX_ROWS;
+  m_state = STATE_NORMAL;
+  m_savedCol = 0;
+  m_savedRow = 0;
+  clear();
+}
+
+void
+Terminal::clear(void)
+{
+  memset(m_cells, ' ', sizeof(m_cells));
+  m_top = 0;
+  m_col = 0;
+  m_row = 0;
+  m_wrap = false;
+  m_oled->clear();
+  m_oled->setStartLine(0);
+}
+
+size_t
+Terminal::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++) {
+    write(buffer[i]);
+  }
+  return size;
+}
+
+size_t
+Terminal::write(uint8_t c)
+{
+  switch (m_state) {
+  case STATE_ESC:
+    m_state = STATE_NORMAL;
+    switch (c) {
+    case '[':
+      m_state = STATE_CSI;
+      m_nParam = 0;
+      memset(m_param, 0, sizeof(m_param));
+      break;
+    case '7':
+      m_savedCol = m_col;
+      m_savedRow = m_row;
+      break;
+    case '8':
+      m_col = m_savedCol;
+      m_row = m_savedRow;
+      m_wrap = false;
+      break;
+    case 'c':
+      clear();
+      break;
+    }
+    return 1;
+
+  case STATE_CSI:
+    if (c >= '0' && c <= '9') {
+      if (m_nParam < TERMINAL_MAX_PARAMS) {
+        m_param[m_nParam] = m_param[m_nParam] * 10 + (c - '0');
+      }
+      return 1;
+    }
+    if (c == ';') {
+      m_nParam++;
+      return 1;
+    }
+    if (c == '?' || c == '>') {
+      m_state = STATE_IGNORE;
+      return 1;
+    }
+    m_nParam++;
+    m_state = STATE_NORMAL;
+    csi(c);
+    return 1;
+
+  case STATE_IGNORE:
+    if (c >= 0x40 && c <= 0x7e) {
+      m_state = STATE_NORMAL;
+    }
+    return 1;
+  }
+
+  switch (c) {
+  case 0x1b:
+    m_state = STATE_ESC;
+    break;
+  case '\r':
+    m_col = 0;
+    m_wrap = false;
+    break;
+  case '\n':
+    // newline, like the SSD1306Ascii console this replaces
+    m_col = 0;
+    m_wrap = false;
+    lineFeed();
+    break;
+  case '\b':
+    if (m_wrap) {
+      m_wrap = false;
+    } else if (m_col > 0) {
+      m_col--;
+    }
+    break;
+  case '\t':
+    m_col = (m_col + 8) & ~7;
+    if (m_col >= m_cols) m_col = m_cols - 1;
+    break;
+  default:
+    if (c < ' ') break;
+    if (m_wrap) {
+      m_col = 0;
+      m_wrap = false;
+      lineFeed();
+    }
+    put(m_row, m_col, c);
+    if (m_col + 1 < m_cols) {
+      m_col++;
+    } else {
+      m_wrap = true;
+    }
+    break;
+  }
+  return 1;
+}
+
+void
+Terminal::csi(uint8_t c)
+{
+  uint8_t n = m_param[0] ? m_param[0] : 1;
+
+  m_wrap = false;
+  switch (c) {
+  case 'A':
+    m_row = m_row > n ? m_row - n : 0;
+    break;
+  case 'B':
+    m_row = m_row + n < m_rows ? m_row + n : m_rows - 1;
+    break;
+  case 'C':
+    m_col = m_col + n < m_cols ? m_col + n : m_cols - 1;
+    break;
+  case 'D':
+    m_col = m_col > n ? m_col - n : 0;
+    break;
+  case 'G':
+    m_col = n <= m_cols ? n - 1 : m_cols - 1;
+    break;
+  case 'H':
+  case 'f':
+    m_row = n <= m_rows ? n - 1 : m_rows - 1;
+    n = m_param[1] ? m_param[1] : 1;
+    m_col = n <= m_cols ? n - 1 : m_cols - 1;
+    break;
+  case 'J':
+    if (m_param[0] == 0) {
+      eraseLine(m_row, m_col, m_cols - 1);
+      for (uint8_t y = m_row + 1; y < m_rows; y++) {
+        eraseLine(y, 0, m_cols - 1);
+      }
+    } else if (m_param[0] == 1) {
+      for (uint8_t y = 0; y < m_row; y++) {
+        eraseLine(y, 0, m_cols - 1);
+      }
+      eraseLine(m_row, 0, m_col);
+    } else if (m_param[0] == 2) {
+      for (uint8_t y = 0; y < m_rows; y++) {
+        eraseLine(y, 0, m_cols - 1);
+      }
+    }
+    break;
+  case 'K':
+    if (m_param[0] == 0) {
+      eraseLine(m_row, m_col, m_cols - 1);
+    } else if (m_param[0] == 1) {
+      eraseLine(m_row, 0, m_col);
+    } else if (m_param[0] == 2) {
+      eraseLine(m_row, 0, m_cols - 1);
+    }
+    break;
+  case '@':
+    insertChars(n);
+    break;
+  case 'P':
+    deleteChars(n);
+    break;
+  }
+}
+
+void
+Terminal::put(uint8_t y, uint8_t x, char c)
+{
+  if (m_cells[y][x] == c) return;
+  m_cells[y][x] = c;
+  draw(y, x);
+}
+
+void
+Terminal::draw(uint8_t y, uint8_t x)
+{
+  // RAM row of the line after hardware scrolling
+  uint8_t r = (m_top + y) % m_rows * m_fontRows;
+  uint8_t c = x * m_cellWidth;
+
+  // clear() leaves the cursor at the top left of the cell
+  m_oled->clear(c, c + m_cellWidth - 1, r, r + m_fontRows - 1);
+  if (m_cells[y][x] != ' ') {
+    m_oled->write(m_cells[y][x]);
+  }
+}
+
+void
+Terminal::lineFeed(void)
+{
+  if (m_row + 1 < m_rows) {
+    m_row++;
+    return;
+  }
+  // scroll up: the old top line becomes the new bottom line
+  memmove(m_cells[0], m_cells[1], (m_rows - 1) * sizeof(m_cells[0]));
+  memset(m_cells[m_rows - 1], ' ', sizeof(m_cells[0]));
+  uint8_t r = m_top * m_fontRows;
+  m_oled->clear(0, m_oled->displayWidth() - 1, r, r + m_fontRows - 1);
+  m_top = (m_top + 1) % m_rows;
+  m_oled->setStartLine(m_top * m_fontRows * 8);
+}
+
+void
+Terminal::eraseLine(uint8_t y, uint8_t x0, uint8_t x1)
+{
+  for (uint8_t x = x0; x <= x1 && x < m_cols; x++) {
+    put(y, x, ' ');
+  }
+}
+
+void
+Terminal::insertChars(uint8_t n)
+{
+  // shift right in place, only cells whose character changes are drawn
+  for (uint8_t x = m_cols - 1; x >= m_col && x < m_cols; x--) {
+    put(m_row, x, x >= m_col + n ? m_cells[m_row][x - n] : ' ');
+  }
+}
+
+void
+Terminal::deleteChars(uint8_t n)
+{
+  for (uint8_t x = m_col; x < m_cols; x++) {
+    put(m_row, x, x + n < m_cols ? m_cells[m_row][x + n] : ' ');
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include "SSD1306Ascii.h"
+
+// Largest character grid (32 x 8 with a 3x6 font on a 128x64 display)
+#define TERMINAL_MAX_COLS   32
+#define TERMINAL_MAX_ROWS   8
+#define TERMINAL_MAX_PARAMS 2
+
+/*
+ * Text terminal on top of SSD1306Ascii.
+ *
+ * Keeps a character grid and repaints only the cells that change.
+ * Scrolling moves the display start line instead of redrawing.
+ * Understands a VT100 subset:
+ *   BS, HT, CR, LF (as newline), ESC 7, ESC 8, ESC c,
+ *   CSI n A/B/C/D/G, CSI r;c H/f, CSI n J/K, CSI n @/P, CSI m (ignored)
+ */
+class Terminal : public Print
+{
+  public:
+    void begin(SSD1306Ascii *oled);
+    void clear(void);
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    using Print::write;
+    uint8_t cols(void) { return m_cols; }
+    uint8_t rows(void) { return m_rows; }
+
+  private:
+    void put(uint8_t y, uint8_t x, char c);
+    void draw(uint8_t y, uint8_t x);
+    void lineFeed(void);
+    void eraseLine(uint8_t y, uint8_t x0, uint8_t x1);
+    void insertChars(uint8_t n);
+    void deleteChars(uint8_t n);
+    void csi(uint8_t c);
+
+    SSD1306Ascii *m_oled;
+    uint8_t m_cols;
+    uint8_t m_rows;
+    uint8_t m_cellWidth;      // pixels
+    uint8_t m_fontRows;       // eight pixel RAM rows per line
+    uint8_t m_top;            // line shown at the top of the display
+    uint8_t m_col;
+    uint8_t m_row;
+    uint8_t m_savedCol;
+    uint8_t m_savedRow;
+    bool m_wrap;              // next character starts a new line
+    uint8_t m_state;
+    uint8_t m_nParam;
+    uint8_t m_param[TERMINAL_MAX_PARAMS];
+    char m_cells[TERMINAL_MAX_ROWS][TERMINAL_MAX_COLS];
+};
+
+#endif
@@ -66,6 +66,12 @@ static const SciInterruptRegistersTableStruct SciInterruptRegistersTable[] = {
   {IER_SCI3_TXI3, 0, IER_SCI3_RXI3, 7, IR_SCI3_TXI3, IR_SCI3_RXI3, IPR_SCI3_TXI3, IPR_SCI3_RXI3, 3},
   {IER_SCI5_TXI5, 6, IER_SCI5_RXI5, 5, IR_SCI5_TXI5, IR_SCI5_RXI5, IPR_SCI5_TXI5, IPR_SCI5_RXI5, 5},
 };
+
+// DMAC channels for useDma(). Channels 0 and 1 belong to the USB host
+// driver. While DTE is set the channel takes the interrupt requests of
+// its source; when a transfer ends they go to the CPU again.
+static volatile st_dmac1 *const dmac_channels[] = { NULL, NULL, &DMAC2, &DMAC3 };
+static volatile unsigned char *const dmac_sources[] = { NULL, NULL, &ICU.DMRSR2, &ICU.DMRSR3 };
 #endif/*GRSAKURA*/
 
 // this next line disables the entire HardwareSerial.cpp, 
@@ -171,9 +177,29 @@ void HardwareSerial::_tx_udr_empty_irq(void)
     cbi(*_ucsrb, UDRIE0);
   }
 #else /*GRSAKURA*/
+  if (_tx_dmac >= 0) {
+    // The DMAC has sent the last run and TXI comes to the CPU again.
+    // Send the first byte of the next run, the DMAC the rest of it.
+    _tx_buffer_tail = (_tx_buffer_tail + _tx_dma_len) & _tx_mask;
+    _tx_dma_len = 0;
+    if (_tx_buffer_head == _tx_buffer_tail) {
+      _sending = false;
+      return;
+    }
+    unsigned int len = (_tx_buffer_head > _tx_buffer_tail ? _tx_buffer_head : _tx_mask + 1) - _tx_buffer_tail;
+    if (len > 1) {
+      volatile st_dmac1 *dmac = dmac_channels[_tx_dmac];
+      dmac->DMSAR = (unsigned long)&_tx_buffer[_tx_buffer_tail + 1];
+      dmac->DMCRA = len - 1;
+      dmac->DMCNT.BYTE = 1;
+    }
+    _tx_dma_len = len;
+    _sci->TDR = _tx_buffer[_tx_buffer_tail];
+    return;
+  }
   if (_tx_buffer_head != _tx_buffer_tail) {
     _sci->TDR = _tx_buffer[_tx_buffer_tail];
-    _tx_buffer_tail = (_tx_buffer_tail + 1) % SERIAL_BUFFER_SIZE;
+    _tx_buffer_tail = (_tx_buffer_tail + 1) & _tx_mask;
   } else {
     _sending = false;
   }
@@ -216,6 +242,7 @@ void HardwareSerial::begin(unsigned long baud, byte config)
   sbi(*_ucsrb, RXCIE0);
   cbi(*_ucsrb, UDRIE0);
 #else /*GRSAKURA*/
+  _alloc_buffers();
   switch (_serial_channel) {
 #if defined(HAVE_HWSERIAL0)
   case 0:
@@ -453,6 +480,15 @@ void HardwareSerial::end()
 #if defined(HAVE_HWSERIAL1) || defined(HAVE_HWSERIAL2) || defined(HAVE_HWSERIAL3) || defined(HAVE_HWSERIAL4) || defined(HAVE_HWSERIAL5) || defined(HAVE_HWSERIAL6) || defined(HAVE_HWSERIAL7)
     {
       flush();
+      if (_tx_dmac >= 0) {
+        dmac_channels[_tx_dmac]->DMCNT.BYTE = 0;
+        _tx_dmac = -1;
+      }
+      if (_rx_dmac >= 0) {
+        _rx_buffer_head = _rx_head();
+        dmac_channels[_rx_dmac]->DMCNT.BYTE = 0;
+        _rx_dmac = -1;
+      }
       {
         const SciInterruptRegistersTableStruct* t = &SciInterruptRegistersTable[_serial_channel - 1];
         ICU.IR[t->_txir].BIT.IR = 0x0;
@@ -476,17 +512,48 @@ void HardwareSerial::end()
   default:
     break;
   }
+  // the pool gets the buffers back, so begin() after setBufferSize()
+  // does not run it dry
+  bool di = isNoInterrupts();
+  noInterrupts();
+  _free_buffers();
+  if (!di) {
+    interrupts();
+  }
 #endif/*GRSAKURA*/
 }
 
 int HardwareSerial::available(void)
 {
+#ifdef GRSAKURA
+  unsigned int n = (_rx_head() - _rx_buffer_tail) & _rx_mask;
+  if (n > _rx_high_water) {
+    // the DMAC does not update it
+    _rx_high_water = n;
+  }
+  return n;
+#else
   return (unsigned int)(SERIAL_BUFFER_SIZE + _rx_buffer_head - _rx_buffer_tail) % SERIAL_BUFFER_SIZE;
+#endif
+}
+
+int HardwareSerial::availableForWrite(void)
+{
+  // one slot is kept empty to tell a full buffer from an empty one
+#ifdef GRSAKURA
+  return (_tx_buffer_tail - _tx_buffer_head - 1) & _tx_mask;
+#else
+  return (unsigned int)(SERIAL_BUFFER_SIZE - 1 + _tx_buffer_tail - _tx_buffer_head) % SERIAL_BUFFER_SIZE;
+#endif
 }
 
 int HardwareSerial::peek(void)
 {
+#ifdef GRSAKURA
+  if (_rx_head() == _rx_buffer_tail) {
+#else
   if (_rx_buffer_head == _rx_buffer_tail) {
+#endif
     return -1;
   } else {
     return _rx_buffer[_rx_buffer_tail];
@@ -496,11 +563,17 @@ int HardwareSerial::peek(void)
 int HardwareSerial::read(void)
 {
   // if the head isn't ahead of the tail, we don't have any characters
+#ifdef GRSAKURA
+  if (_rx_head() == _rx_buffer_tail) {
+#else
   if (_rx_buffer_head == _rx_buffer_tail) {
+#endif
     return -1;
   } else {
     unsigned char c = _rx_buffer[_rx_buffer_tail];
-#if SERIAL_BUFFER_SIZE < 256
+#ifdef GRSAKURA
+    _rx_buffer_tail = (_rx_buffer_tail + 1) & _rx_mask;
+#elif SERIAL_BUFFER_SIZE < 256
 	_rx_buffer_tail = (uint8_t)(_rx_buffer_tail + 1) % SERIAL_BUFFER_SIZE;
 #else
 	_rx_buffer_tail = (uint32_t)(_rx_buffer_tail + 1) % SERIAL_BUFFER_SIZE;
@@ -530,10 +603,10 @@ void HardwareSerial::flush()
   // the hardware finished tranmission (TXC is set).
 #else /*GRSAKURA*/
   while (_tx_buffer_head != _tx_buffer_tail) {
-    ;
+    _tx_poll();
   }
   while (_sending) {
-    ;
+    _tx_poll();
   }
 #endif/*GRSAKURA*/
 }
@@ -579,7 +652,7 @@ size_t HardwareSerial::write(uint8_t c)
 #if defined(HAVE_HWSERIAL0)
   case 0:
     {
-        unsigned int i = (_tx_buffer_head + 1) % SERIAL_BUFFER_SIZE;
+        unsigned int i = (_tx_buffer_head + 1) & _tx_mask;
 
         if (_begin) {
             if (i != _tx_buffer_tail) {
@@ -623,13 +696,13 @@ size_t HardwareSerial::write(uint8_t c)
 #endif
 #if defined(HAVE_HWSERIAL1) || defined(HAVE_HWSERIAL2) || defined(HAVE_HWSERIAL3) || defined(HAVE_HWSERIAL4) || defined(HAVE_HWSERIAL5) || defined(HAVE_HWSERIAL6) || defined(HAVE_HWSERIAL7)
     {
-      unsigned int i = (_tx_buffer_head + 1) % SERIAL_BUFFER_SIZE;
+      unsigned int i = (_tx_buffer_head + 1) & _tx_mask;
       // If the output buffer is full, there's nothing for it other than to
       // wait for the interrupt handler to empty it a bit
       // ???: return 0 here instead?
       if (_begin) {
         while (i == _tx_buffer_tail) {
-          ;
+          _tx_poll();
         }
         _tx_buffer[_tx_buffer_head] = c;
         _tx_buffer_head = i;
@@ -658,13 +731,312 @@ size_t HardwareSerial::write(uint8_t c)
 #endif/*GRSAKURA*/
 }
 
+#ifdef GRSAKURA
+static unsigned char serial_pool[SERIAL_POOL_SIZE] __attribute__((aligned(4)));
+static unsigned int serial_pool_used = 0;
+
+// Buffers given back below the top of the pool, reused for the same size
+#define SERIAL_POOL_FREE 8
+static struct {
+  unsigned char *p;
+  uint16_t size;
+} serial_pool_free[SERIAL_POOL_FREE];
+
+static unsigned int serial_round_size(unsigned int size)
+{
+  unsigned int n = 16;
+  while (n < size && n < 0x8000) {
+    n <<= 1;
+  }
+  return n;
+}
+
+static unsigned char *serial_alloc(uint16_t *size)
+{
+  while (*size >= 16) {
+    for (int i = 0; i < SERIAL_POOL_FREE; i++) {
+      if (serial_pool_free[i].p && serial_pool_free[i].size == *size) {
+        unsigned char *p = serial_pool_free[i].p;
+        serial_pool_free[i].p = NULL;
+        return p;
+      }
+    }
+    if (serial_pool_used + *size <= SERIAL_POOL_SIZE) {
+      unsigned char *p = &serial_pool[serial_pool_used];
+      serial_pool_used += *size;
+      return p;
+    }
+    *size /= 2;
+  }
+  *size = 1;
+  return serial_no_buffer;
+}
+
+// The top of the pool shrinks, other buffers wait in the free list
+static void serial_free(unsigned char *p, uint16_t size)
+{
+  if (p == serial_no_buffer) {
+    return;
+  }
+  if (p + size == &serial_pool[serial_pool_used]) {
+    serial_pool_used -= size;
+    // free buffers that are now on top go back as well
+    for (int i = 0; i < SERIAL_POOL_FREE; i++) {
+      unsigned char *q = serial_pool_free[i].p;
+      if (q && q + serial_pool_free[i].size == &serial_pool[serial_pool_used]) {
+        serial_pool_used -= serial_pool_free[i].size;
+        serial_pool_free[i].p = NULL;
+        i = -1;
+      }
+    }
+    return;
+  }
+  for (int i = 0; i < SERIAL_POOL_FREE; i++) {
+    if (!serial_pool_free[i].p) {
+      serial_pool_free[i].p = p;
+      serial_pool_free[i].size = size;
+      return;
+    }
+  }
+  // free list full, the buffer stays lost
+}
+
+void HardwareSerial::setBufferSize(unsigned int rx_size, unsigned int tx_size)
+{
+  if (_begin) {
+    return;
+  }
+  rx_size = serial_round_size(rx_size);
+  tx_size = serial_round_size(tx_size);
+  if (rx_size != _rx_size) {
+    _free_buffers();
+    _rx_size = rx_size;
+  }
+  if (tx_size != _tx_size) {
+    _free_buffers();
+    _tx_size = tx_size;
+  }
+}
+
+// Give the buffers back to the pool, begin() takes new ones
+void HardwareSerial::_free_buffers(void)
+{
+  // last allocated first, so both can come off the top of the pool
+  if (_tx_buffer != serial_no_buffer) {
+    serial_free(_tx_buffer, _tx_mask + 1);
+    _tx_buffer = serial_no_buffer;
+    _tx_mask = 0;
+  }
+  if (_rx_buffer != serial_no_buffer) {
+    serial_free(_rx_buffer, _rx_mask + 1);
+    _rx_buffer = serial_no_buffer;
+    _rx_mask = 0;
+  }
+}
+
+void HardwareSerial::_alloc_buffers(void)
+{
+  if (_rx_buffer == serial_no_buffer) {
+    _rx_buffer = serial_alloc(&_rx_size);
+    _rx_mask = _rx_size - 1;
+    _rx_buffer_head = _rx_buffer_tail = 0;
+  }
+  if (_tx_buffer == serial_no_buffer) {
+    _tx_buffer = serial_alloc(&_tx_size);
+    _tx_mask = _tx_size - 1;
+    _tx_buffer_head = _tx_buffer_tail = 0;
+  }
+}
+
+bool HardwareSerial::useDma(int tx_channel, int rx_channel)
+{
+  if (_serial_channel < 1 || !_begin ||
+      (tx_channel >= 0 && (tx_channel < 2 || tx_channel > 3)) ||
+      (rx_channel >= 0 && (rx_channel < 2 || rx_channel > 3)) ||
+      (tx_channel >= 0 && tx_channel == rx_channel)) {
+    return false;
+  }
+  const SciInterruptRegistersTableStruct* t = &SciInterruptRegistersTable[_serial_channel - 1];
+
+  // let the interrupt driven transmission finish first
+  flush();
+
+  bool di = isNoInterrupts();
+  noInterrupts();
+  startModule(MstpIdDMAC);
+  DMAC.DMAST.BYTE = 1;
+  if (tx_channel >= 0) {
+    volatile st_dmac1 *dmac = dmac_channels[tx_channel];
+    dmac->DMCNT.BYTE = 0;
+    dmac->DMAMD.WORD = 0x8000;  // source incremented, destination fixed
+    dmac->DMTMD.WORD = 0x2001;  // normal transfer, 8 bits, started by the peripheral
+    dmac->DMINT.BYTE = 0;
+    dmac->DMCSL.BYTE = 0;
+    dmac->DMDAR = (unsigned long)&_sci->TDR;
+    *dmac_sources[tx_channel] = t->_txir;
+    _tx_dma_len = 0;
+    _tx_dmac = tx_channel;
+  }
+  if (rx_channel >= 0) {
+    volatile st_dmac1 *dmac = dmac_channels[rx_channel];
+    dmac->DMCNT.BYTE = 0;
+    dmac->DMAMD.WORD = 0x0080;  // source fixed, destination incremented
+    dmac->DMTMD.WORD = 0x2001;
+    dmac->DMINT.BYTE = 0;
+    dmac->DMCSL.BYTE = 0;
+    dmac->DMSAR = (unsigned long)&_sci->RDR;
+    *dmac_sources[rx_channel] = t->_rxir;
+    _rx_dmac = rx_channel;
+    _rx_dma_start();
+  }
+  if (!di) {
+    interrupts();
+  }
+  return true;
+}
+
+// Where the next received byte goes. The DMAC writes without the CPU,
+// so its destination address is the head while it runs.
+unsigned int HardwareSerial::_rx_head(void)
+{
+  if (_rx_dmac < 0) {
+    return _rx_buffer_head;
+  }
+  return (dmac_channels[_rx_dmac]->DMDAR - (unsigned long)_rx_buffer) & _rx_mask;
+}
+
+// Receive from the head up to the end of the buffer. The RXI after that
+// comes to the CPU, which takes the byte and restarts the channel.
+void HardwareSerial::_rx_dma_start(void)
+{
+  volatile st_dmac1 *dmac = dmac_channels[_rx_dmac];
+  dmac->DMDAR = (unsigned long)&_rx_buffer[_rx_buffer_head];
+  dmac->DMCRA = _rx_mask + 1 - _rx_buffer_head;
+  dmac->DMCNT.BYTE = 1;
+}
+
+// With interrupts masked nothing empties the transmit buffer. Take the
+// pending TXI from the ICU and do what its handler would have done.
+void HardwareSerial::_tx_poll(void)
+{
+  if (_serial_channel < 1 || !isNoInterrupts()) {
+    return;
+  }
+  const SciInterruptRegistersTableStruct* t = &SciInterruptRegistersTable[_serial_channel - 1];
+  if (ICU.IR[t->_txir].BIT.IR) {
+    ICU.IR[t->_txir].BIT.IR = 0x0;
+    _tx_udr_empty_irq();
+  }
+}
+
+// Contiguous free bytes from the head of the transmit buffer
+unsigned int HardwareSerial::_tx_free_span(void)
+{
+  uint32_t tail = _tx_buffer_tail;
+  if (tail > _tx_buffer_head) {
+    return tail - _tx_buffer_head - 1;
+  }
+  return _tx_mask + 1 - _tx_buffer_head - (tail == 0 ? 1 : 0);
+}
+
+// Copy whole runs instead of one byte per call. Like write(uint8_t), the
+// SCI waits for room and the USB port drops what does not fit.
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  if (!_begin) {
+    return Print::write(buffer, size);
+  }
+  size_t n = 0;
+  while (n < size) {
+    unsigned int len = _tx_free_span();
+    if (len == 0) {
+      if (_serial_channel == 0) {
+        break;
+      }
+      _tx_poll();
+      continue;
+    }
+    if (len > size - n) {
+      len = size - n;
+    }
+    memcpy(&_tx_buffer[_tx_buffer_head], buffer + n, len);
+    n += len;
+#if defined(HAVE_HWSERIAL0)
+    if (_serial_channel == 0) {
+      USB0.INTENB0.BIT.BRDYE = 0;
+      _tx_buffer_head = (_tx_buffer_head + len) & _tx_mask;
+      USB0.INTENB0.BIT.BRDYE = 1;
+      USB0.BRDYENB.BIT.PIPE2BRDYE = 1;
+      continue;
+    }
+#endif
+    _tx_buffer_head = (_tx_buffer_head + len) & _tx_mask;
+    if (!_sending) {
+      bool di = isNoInterrupts();
+      noInterrupts();
+      _sending = true;
+      _tx_udr_empty_irq();
+      if (!di) {
+        interrupts();
+      }
+    }
+  }
+  return n;
+}
+
+size_t HardwareSerial::read(uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (n < size) {
+    uint32_t head = _rx_head();
+    unsigned int len = (head >= _rx_buffer_tail ? head : _rx_mask + 1) - _rx_buffer_tail;
+    if (len == 0) {
+      break;
+    }
+    if (len > size - n) {
+      len = size - n;
+    }
+    memcpy(buffer + n, &_rx_buffer[_rx_buffer_tail], len);
+    _rx_buffer_tail = (_rx_buffer_tail + len) & _rx_mask;
+    n += len;
+  }
+  return n;
+}
+
+// What has arrived is copied at once, the rest as Stream::readBytes()
+size_t HardwareSerial::readBytes(char *buffer, size_t length)
+{
+  size_t n = read((uint8_t *)buffer, length);
+  if (n < length) {
+    n += Stream::readBytes(buffer + n, length - n);
+  }
+  return n;
+}
+#endif/*GRSAKURA*/
+
 
 #endif // whole file
 
 #ifdef GRSAKURA
 #include "rx63n/interrupt_handlers.h"
 
+// SCI units in simple I2C mode share RXI/TXI with the UART; the Wire
+// transfer engine claims the event while it has a transfer queued.
+extern "C" bool twi_rx_rxi(uint8_t channel) __attribute__((weak));
+extern "C" bool twi_rx_txi(uint8_t channel) __attribute__((weak));
+#define SCI_I2C_RXI(sci) if (twi_rx_rxi && twi_rx_rxi(sci)) return
+#define SCI_I2C_TXI(sci) if (twi_rx_txi && twi_rx_txi(sci)) return
+
 #ifdef HAVE_HWSERIAL0
+// The USB console passes received bytes to serialRxHook like the SCI does
+static inline void store_usb_char(uint8_t c)
+{
+    if (serialRxHook && serialRxHook(0, c)) {
+        return;
+    }
+    Serial._store_char(c);
+}
+
 extern "C"{
 void ReadBulkOUTPacket(void)
 {
@@ -698,12 +1070,12 @@ void ReadBulkOUTPacket(void)
         uint16_t Data = USBIO.D1FIFO;
         if(DataLength >= 2){
             /*Save first byte*/
-            Serial._store_char((uint8_t)Data);
+            store_usb_char((uint8_t)Data);
             /*Save second byte*/
-            Serial._store_char((uint8_t)(Data>>8));
+            store_usb_char((uint8_t)(Data>>8));
             DataLength-=2;
         } else {
-            Serial._store_char((uint8_t)Data);
+            store_usb_char((uint8_t)Data);
             DataLength--;
         }
     }
@@ -714,6 +1086,17 @@ void WriteBulkINPacket(void)
 {
     uint32_t Count = 0;
 
+    /*A transfer from USBCDC_Write_Async goes first, the transmit buffer
+    follows when it has finished*/
+    if(USBHAL_Bulk_IN_Packet())
+    {
+        if(Serial._buffer_available())
+        {
+            USBIO.BRDYENB.BIT.PIPE2BRDYE = 1;
+        }
+        return;
+    }
+
     /*Write data to Bulk IN pipe using D0FIFO*/
     /*Select pipe (Check this happens before continuing)*/
     /*Set 8 bit access*/
@@ -727,11 +1110,25 @@ void WriteBulkINPacket(void)
     while(USBIO.D0FIFOCTR.BIT.FRDY == 0){;}
 
     /* Write data to the IN Fifo until have written a full packet
-     or we have no more data to write */
-    while((Count < BULK_IN_PACKET_SIZE) && Serial._buffer_available())
+     or we have no more data to write, a contiguous run at a time */
+    while(Count < BULK_IN_PACKET_SIZE)
     {
-        USBIO.D0FIFO = Serial._extract_char();
-        Count++;
+        const unsigned char *p;
+        unsigned int n = Serial._tx_span(&p);
+        if(n == 0)
+        {
+            break;
+        }
+        if(n > BULK_IN_PACKET_SIZE - Count)
+        {
+            n = BULK_IN_PACKET_SIZE - Count;
+        }
+        for(unsigned int i = 0; i < n; i++)
+        {
+            USBIO.D0FIFO = p[i];
+        }
+        Serial._tx_skip(n);
+        Count += n;
     }
 
     /*Send the packet */
@@ -759,11 +1156,13 @@ HardwareSerial Serial(0, NULL, MstpIdINVALID, INVALID_IO, INVALID_IO);
 #ifdef HAVE_HWSERIAL1
 void INT_Excep_SCI0_RXI0()
 {
+  SCI_I2C_RXI(0);
   Serial1._rx_complete_irq();
 }
 
 void INT_Excep_SCI0_TXI0()
 {
+  SCI_I2C_TXI(0);
   Serial1._tx_udr_empty_irq();
 }
 
@@ -777,11 +1176,13 @@ HardwareSerial Serial1(1, &SCI0, MstpIdSCI0, PIN_IO0, PIN_IO1);
 #ifdef HAVE_HWSERIAL2
 void INT_Excep_SCI2_RXI2()
 {
+  SCI_I2C_RXI(2);
   Serial2._rx_complete_irq();
 }
 
 void INT_Excep_SCI2_TXI2()
 {
+  SCI_I2C_TXI(2);
   Serial2._tx_udr_empty_irq();
 }
 
@@ -795,11 +1196,13 @@ HardwareSerial Serial2(2, &SCI2, MstpIdSCI2, PIN_IO5, PIN_IO6);
 #ifdef HAVE_HWSERIAL3
 void INT_Excep_SCI6_RXI6()
 {
+  SCI_I2C_RXI(6);
   Serial3._rx_complete_irq();
 }
 
 void INT_Excep_SCI6_TXI6()
 {
+  SCI_I2C_TXI(6);
   Serial3._tx_udr_empty_irq();
 }
 
@@ -813,11 +1216,13 @@ HardwareSerial Serial3(3, &SCI6, MstpIdSCI6, PIN_IO7, PIN_IO8);
 #ifdef HAVE_HWSERIAL4
 void INT_Excep_SCI8_RXI8()
 {
+  SCI_I2C_RXI(8);
   Serial4._rx_complete_irq();
 }
 
 void INT_Excep_SCI8_TXI8()
 {
+  SCI_I2C_TXI(8);
   Serial4._tx_udr_empty_irq();
 }
 
@@ -831,11 +1236,13 @@ HardwareSerial Serial4(4, &SCI8, MstpIdSCI8, PIN_IO12, PIN_IO11);
 #ifdef HAVE_HWSERIAL5
 void INT_Excep_SCI1_RXI1()
 {
+  SCI_I2C_RXI(1);
   Serial5._rx_complete_irq();
 }
 
 void INT_Excep_SCI1_TXI1()
 {
+  SCI_I2C_TXI(1);
   Serial5._tx_udr_empty_irq();
 }
 
@@ -849,11 +1256,13 @@ HardwareSerial Serial5(5, &SCI1, MstpIdSCI1, PIN_IO26, PIN_IO22);
 #ifdef HAVE_HWSERIAL6
 void INT_Excep_SCI3_RXI3()
 {
+  SCI_I2C_RXI(3);
   Serial6._rx_complete_irq();
 }
 
 void INT_Excep_SCI3_TXI3()
 {
+  SCI_I2C_TXI(3);
   Serial6._tx_udr_empty_irq();
 }
 
@@ -867,11 +1276,13 @@ HardwareSerial Serial6(6, &SCI3, MstpIdSCI3, PIN_IO29, PIN_IO23);
 #ifdef HAVE_HWSERIAL7
 void INT_Excep_SCI5_RXI5()
 {
+  SCI_I2C_RXI(5);
   Serial7._rx_complete_irq();
 }
 
 void INT_Excep_SCI5_TXI5()
 {
+  SCI_I2C_TXI(5);
   Serial7._tx_udr_empty_irq();
 }
 
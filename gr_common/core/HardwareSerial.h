@@ -44,7 +44,10 @@
   #define SERIAL_BUFFER_SIZE 64
 #endif
 #else /*GRSAKURA*/
+  // Default size of each buffer. The buffers of a port are taken from a
+  // shared pool at its first begin(), so ports never begun cost no RAM.
   #define SERIAL_BUFFER_SIZE 1024
+  #define SERIAL_POOL_SIZE (8 * 1024)
 #endif/*GRSAKURA*/
 
 // Define config for Serial.begin(baud, config);
@@ -73,6 +76,12 @@
 #define SERIAL_7O2 0x3C
 #define SERIAL_8O2 0x3E
 
+#ifdef GRSAKURA
+// Called from the receive interrupt with each good byte.
+// Return true to take the byte instead of the receive buffer.
+extern bool serialRxHook(int serial_channel, unsigned char c) __attribute__((weak));
+#endif/*GRSAKURA*/
+
 class HardwareSerial : public Stream
 {
   protected:
@@ -93,6 +102,9 @@ class HardwareSerial : public Stream
     int8_t _serial_channel;
     volatile bool _sending;
     volatile bool _begin;
+    int8_t _tx_dmac;
+    int8_t _rx_dmac;
+    volatile uint16_t _tx_dma_len;
 #endif/*GRSAKURA*/
 
 #if SERIAL_BUFFER_SIZE < 256
@@ -107,11 +119,23 @@ class HardwareSerial : public Stream
     volatile uint32_t _tx_buffer_tail;
 #endif
 
+#ifndef GRSAKURA
     // Don't put any members after these buffers, since only the first
     // 32 bytes of this struct can be accessed quickly using the ldd
     // instruction.
     unsigned char _rx_buffer[SERIAL_BUFFER_SIZE];
     unsigned char _tx_buffer[SERIAL_BUFFER_SIZE];
+#else /*GRSAKURA*/
+    // Sizes are powers of two, indexes are masked instead of divided
+    unsigned char *_rx_buffer;
+    unsigned char *_tx_buffer;
+    uint32_t _rx_mask;
+    uint32_t _tx_mask;
+    uint16_t _rx_size;
+    uint16_t _tx_size;
+    volatile uint32_t _rx_high_water;
+    volatile unsigned long _rx_overruns;
+#endif/*GRSAKURA*/
 
   public:
 #ifndef GRSAKURA
@@ -131,6 +155,26 @@ class HardwareSerial : public Stream
     void begin(unsigned long, uint8_t);
     void end();
     virtual int available(void);
+    int availableForWrite(void);
+#ifdef GRSAKURA
+    // Buffer sizes for the next begin(), rounded up to a power of two.
+    // A smaller size is used when the pool runs short.
+    void setBufferSize(unsigned int rx_size, unsigned int tx_size);
+    // Most bytes waiting in the receive buffer, and bytes lost because
+    // the buffer was full or the SCI overran
+    unsigned int rxHighWater(void) { return _rx_high_water; }
+    // Bytes the transmit buffer holds when full, as begin() sized it
+    unsigned int txCapacity(void) { return _tx_mask; }
+    unsigned long overruns(void) { return _rx_overruns; }
+    // Copy what has arrived, without waiting
+    size_t read(uint8_t *buffer, size_t size);
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    // Move transmit runs and received bytes with DMAC channel 2 or 3,
+    // -1 for none. Call after begin(). Bytes received by the DMAC are
+    // not passed to serialRxHook.
+    bool useDma(int tx_channel, int rx_channel = -1);
+#endif/*GRSAKURA*/
     virtual int peek(void);
     virtual int read(void);
     virtual void flush(void);
@@ -140,6 +184,9 @@ class HardwareSerial : public Stream
     inline size_t write(unsigned int n) { return write((uint8_t)n); }
     inline size_t write(int n) { return write((uint8_t)n); }
     using Print::write; // pull in write(str) and write(buf, size) from Print
+#ifdef GRSAKURA
+    virtual size_t write(const uint8_t *buffer, size_t size);
+#endif/*GRSAKURA*/
     operator bool() { return true; }
 
     // Interrupt handlers - Not intended to be called externally
@@ -150,6 +197,14 @@ class HardwareSerial : public Stream
     inline bool _store_char(unsigned char c);
     inline unsigned char _extract_char();
     bool _buffer_available();
+    unsigned int _tx_span(const unsigned char **p);
+    void _tx_skip(unsigned int n);
+    unsigned int _rx_head(void);
+    void _rx_dma_start(void);
+    void _alloc_buffers(void);
+    void _free_buffers(void);
+    void _tx_poll(void);
+    unsigned int _tx_free_span(void);
 #endif/*GRSAKURA*/
     void _tx_udr_empty_irq(void);
 };
@@ -95,6 +95,10 @@ HardwareSerial::HardwareSerial(
 {
 }
 #else /*GRSAKURA*/
+// Stands in for the buffers until begin(). With a mask of 0 it is
+// always full and always empty, so nothing is stored or read.
+static unsigned char serial_no_buffer[1];
+
 HardwareSerial::HardwareSerial(
   int serial_channel,
   volatile st_sci0* sci,
@@ -106,8 +110,15 @@ HardwareSerial::HardwareSerial(
     _serial_channel(serial_channel),
     _sending(false),
     _begin(false),
+    _tx_dmac(-1),
+    _rx_dmac(-1),
+    _tx_dma_len(0),
     _rx_buffer_head(0), _rx_buffer_tail(0),
-    _tx_buffer_head(0), _tx_buffer_tail(0)
+    _tx_buffer_head(0), _tx_buffer_tail(0),
+    _rx_buffer(serial_no_buffer), _tx_buffer(serial_no_buffer),
+    _rx_mask(0), _tx_mask(0),
+    _rx_size(SERIAL_BUFFER_SIZE), _tx_size(SERIAL_BUFFER_SIZE),
+    _rx_high_water(0), _rx_overruns(0)
 {
 }
 #endif/*GRSAKURA*/
@@ -136,12 +147,23 @@ void HardwareSerial::_rx_complete_irq(void)
     *_udr;
   };
 #else /*GRSAKURA*/
+  if (_rx_dmac >= 0) {
+    // The DMAC stopped at the end of the buffer, so the CPU takes this
+    // byte and starts the next pass after it.
+    _rx_buffer_head = _rx_head();
+  }
   unsigned char c = _sci->RDR;
   st_sci0_ssr ssr;
   ssr.BYTE = _sci->SSR.BYTE;
   if (ssr.BIT.ORER == 0 && ssr.BIT.FER == 0 && ssr.BIT.PER == 0) {
+    if (_rx_dmac < 0 && serialRxHook && serialRxHook(_serial_channel, c)) {
+      return;
+    }
     _store_char(c);
   } else {
+    if (ssr.BIT.ORER) {
+      _rx_overruns++;
+    }
     ssr.BIT.ORER = 0;
     ssr.BIT.FER = 0;
     ssr.BIT.PER = 0;
@@ -156,22 +178,26 @@ void HardwareSerial::_rx_complete_irq(void)
       _sci->SSR.BYTE = ssr.BYTE;
     }
   }
+  if (_rx_dmac >= 0) {
+    _rx_dma_start();
+  }
 #endif/*GRSAKURA*/
 }
 
 #ifdef GRSAKURA
 bool HardwareSerial::_store_char(unsigned char c)
 {
-#if SERIAL_BUFFER_SIZE < 256
-  uint8_t i = (uint8_t)(_rx_buffer_head + 1) % SERIAL_BUFFER_SIZE;
-#else
-  uint32_t i = (uint32_t)(_rx_buffer_head + 1) % SERIAL_BUFFER_SIZE;
-#endif
+  uint32_t i = (_rx_buffer_head + 1) & _rx_mask;
   if (i != _rx_buffer_tail) {
     _rx_buffer[_rx_buffer_head] = c;
     _rx_buffer_head = i;
+    uint32_t n = (i - _rx_buffer_tail) & _rx_mask;
+    if (n > _rx_high_water) {
+      _rx_high_water = n;
+    }
     return 1;
   } else {
+    _rx_overruns++;
     return 0;
   }
 }
@@ -180,7 +206,7 @@ unsigned char HardwareSerial::_extract_char()
 {
     unsigned char c = _tx_buffer[_tx_buffer_tail];
     if (_tx_buffer_head != _tx_buffer_tail) {
-      _tx_buffer_tail = (_tx_buffer_tail + 1) % SERIAL_BUFFER_SIZE;
+      _tx_buffer_tail = (_tx_buffer_tail + 1) & _tx_mask;
     }
     return c;
 }
@@ -189,6 +215,18 @@ bool HardwareSerial::_buffer_available()
     return (_tx_buffer_head != _tx_buffer_tail);
 }
 
+// Bytes waiting up to the end of the transmit buffer, starting at *p
+unsigned int HardwareSerial::_tx_span(const unsigned char **p)
+{
+    *p = &_tx_buffer[_tx_buffer_tail];
+    return (_tx_buffer_head >= _tx_buffer_tail ? _tx_buffer_head : _tx_mask + 1) - _tx_buffer_tail;
+}
+
+void HardwareSerial::_tx_skip(unsigned int n)
+{
+    _tx_buffer_tail = (_tx_buffer_tail + n) & _tx_mask;
+}
+
 #endif/*GRSAKURA*/
 
 #endif // whole file
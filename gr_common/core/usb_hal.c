@@ -208,9 +208,8 @@ static void SetDefaultInterrupts(void);
 
 /*Operations*/
 static void WriteControlINPacket(void);
-#if 0
-static void WriteBulkINPacket(void);
-#endif
+/*BULK IN from the buffer of USBHAL_Bulk_IN, see USBHAL_Bulk_IN_Packet*/
+static void WriteBulkINBuffer(void);
 extern void WriteBulkINPacket(void);
 static void WriteIntINPacket(void);
 static void ReadControlOUTPacket(void);
@@ -552,9 +551,6 @@ USB_ERR USBHAL_Bulk_IN(uint32_t _NumBytes, const uint8_t* _Buffer, CB_DONE _CBDo
         }
         else
         {
-            /*Set busy flag*/
-            g_Bulk.m_INBusy = true;
-
             DEBUG_MSG_MID(("USBHAL: BULK IN start, %lu bytes.\r\n", _NumBytes));
 
             /*Setup data buffer*/
@@ -562,6 +558,11 @@ USB_ERR USBHAL_Bulk_IN(uint32_t _NumBytes, const uint8_t* _Buffer, CB_DONE _CBDo
             g_Bulk.m_IN.m_DataBuff.NumBytes = _NumBytes;
             g_Bulk.m_IN.m_fpDone = _CBDone;
 
+            /*Set busy flag.
+            NOTE After the buffer, as a BRDY interrupt for the Serial
+            transmit buffer may come in between and send from it.*/
+            g_Bulk.m_INBusy = true;
+
             /*Write packet. Do this be enabling BRDY interrupt for BULK IN pipe.
             The actual packet will be written out when get the BRDY interrupt.*/
             USBIO.BRDYENB.BIT.PIPE2BRDYE = 1;
@@ -1362,7 +1363,68 @@ End WriteIntINPacket function
 **********************************************************************/
 
 /**********************************************************************
-* Outline       : WriteBulkINPacket
+* Outline       : USBHAL_Bulk_IN_Packet
+* Description   : Called for a BULK IN BRDY interrupt. Writes the next
+*                 packet of a transfer started by USBHAL_Bulk_IN.
+*                 The BRDY interrupt is disabled and the callback called
+*                 when the transfer has finished.
+* Argument      : none
+* Return value  : false if no transfer is busy.
+**********************************************************************/
+bool USBHAL_Bulk_IN_Packet(void)
+{
+    if(false == g_Bulk.m_INBusy)
+    {
+        return false;
+    }
+    WriteBulkINBuffer();
+    return true;
+}
+/**********************************************************************
+End USBHAL_Bulk_IN_Packet function
+**********************************************************************/
+
+/**********************************************************************
+* Outline       : USBHAL_Bulk_IN_Cancel
+* Description   : Abandon a transfer started by USBHAL_Bulk_IN that the
+*                 host does not take. Clears the pipe buffer and calls
+*                 the callback with USB_ERR_CANCEL.
+*                 NOTE Bytes in the Serial transmit buffer wait for the
+*                 next write, which enables the BRDY interrupt again.
+* Argument      : none
+* Return value  : none
+**********************************************************************/
+void USBHAL_Bulk_IN_Cancel(void)
+{
+    CB_DONE CBTemp = NULL;
+
+    /*Keep the BRDY interrupt from finishing the transfer meanwhile*/
+    USBIO.INTENB0.BIT.BRDYE = 0;
+    if(true == g_Bulk.m_INBusy)
+    {
+        DEBUG_MSG_MID(("USBHAL: BULK IN cancel\r\n"));
+
+        USBIO.BRDYENB.BIT.PIPE2BRDYE = 0;
+        /*Drop the packets waiting in the pipe buffer*/
+        USBHAL_Bulk_IN_Stall_Clear();
+
+        CBTemp = g_Bulk.m_IN.m_fpDone;
+        g_Bulk.m_IN.m_DataBuff.NumBytes = 0;
+        g_Bulk.m_INBusy = false;
+    }
+    USBIO.INTENB0.BIT.BRDYE = 1;
+
+    if(NULL != CBTemp)
+    {
+        CBTemp(USB_ERR_CANCEL);
+    }
+}
+/**********************************************************************
+End USBHAL_Bulk_IN_Cancel function
+**********************************************************************/
+
+/**********************************************************************
+* Outline       : WriteBulkINBuffer
 * Description   : If the Bulk IN buffer contains data then this will
 *                 write it to the pipe buffer until either the packet is
 *                 full or all the data has been written.
@@ -1372,8 +1434,7 @@ End WriteIntINPacket function
 * Argument      : none
 * Return value  : none
 **********************************************************************/
-#if 0
-static void WriteBulkINPacket(void)
+static void WriteBulkINBuffer(void)
 {
     uint32_t Count = 0;
 
@@ -1490,9 +1551,8 @@ static void WriteBulkINPacket(void)
         USBIO.BRDYENB.BIT.PIPE2BRDYE = 1;
     }
 }
-#endif
 /**********************************************************************
-End WriteBulkINPacket function
+End WriteBulkINBuffer function
 **********************************************************************/
 
 /**********************************************************************
@@ -115,6 +115,8 @@ USB_ERR USBHAL_Control_IN(uint16_t _NumBytes, const uint8_t* _Buffer);
 USB_ERR USBHAL_Control_OUT(uint16_t _NumBytes, uint8_t* _Buffer, CB_DONE_OUT _CBDone);
 /*Bulk*/
 USB_ERR USBHAL_Bulk_IN(uint32_t _NumBytes, const uint8_t* _Buffer, CB_DONE _CBDone);
+bool USBHAL_Bulk_IN_Packet(void);
+void USBHAL_Bulk_IN_Cancel(void);
 USB_ERR USBHAL_Bulk_OUT(uint32_t _NumBytes, uint8_t* _Buffer, CB_DONE_OUT _CBDone);
 
 /*Interrupt*/
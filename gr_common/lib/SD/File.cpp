@@ -18,10 +18,23 @@
    uint8_t nfilecount=0;
 */
 
+// Open files live here instead of the heap, a slot is free while its
+// SdFile is closed. Each keeps its own cluster position.
+static SdFile openFiles[SD_MAX_OPEN_FILES];
+
 File::File(SdFile f, const char *n) {
-  // oh man you are kidding me, new() doesnt exist? Ok we do it by hand!
-  _file = (SdFile *)malloc(sizeof(SdFile)); 
-  if (_file) {
+  _file = 0;
+  _name[0] = 0;
+  for (uint8_t i = 0; i < SD_MAX_OPEN_FILES; i++) {
+    if (!openFiles[i].isOpen()) {
+      _file = &openFiles[i];
+      break;
+    }
+  }
+  if (!_file) {
+    // table full, the caller sees a closed File
+    f.close();
+  } else {
     memcpy(_file, &f, sizeof(SdFile));
     
     strncpy(_name, n, 12);
@@ -127,7 +140,6 @@ uint32_t File::size() {
 void File::close() {
   if (_file) {
     _file->close();
-    free(_file); 
     _file = 0;
 
     /* for debugging file open/close leaks
@@ -23,6 +23,11 @@
 #define FILE_READ O_READ
 #define FILE_WRITE (O_READ | O_WRITE | O_CREAT)
 
+// Number of files and directories that can be open at the same time
+#ifndef SD_MAX_OPEN_FILES
+#define SD_MAX_OPEN_FILES 4
+#endif
+
 class File : public Stream {
  private:
   char _name[13]; // our name
@@ -70,7 +75,7 @@ public:
   
   // Open the specified file/directory with the supplied mode (e.g. read or
   // write, etc). Returns a File object for interacting with the file.
-  // Note that currently only one file can be open at a time.
+  // Up to SD_MAX_OPEN_FILES files can be open at a time.
   File open(const char *filename, uint8_t mode = FILE_READ);
 
   // Methods to determine if the requested file path exists.
@@ -102,6 +102,24 @@ void spiSend(uint8_t data) {
 }
 #endif  // SOFTWARE_SPI
 //------------------------------------------------------------------------------
+#if defined(USE_SPI_LIB) && defined(GRSAKURA) && !defined(SOFTWARE_SPI)
+/** Receive a run of bytes, by DMAC if SPI has been given channels */
+static void spiRec(uint8_t* buf, uint16_t n) {
+  SPI.transfer(NULL, buf, n);
+}
+/** Send a run of bytes, by DMAC if SPI has been given channels */
+static void spiSend(const uint8_t* buf, uint16_t n) {
+  SPI.transfer(buf, NULL, n);
+}
+#else  // USE_SPI_LIB && GRSAKURA
+static void spiRec(uint8_t* buf, uint16_t n) {
+  for (uint16_t i = 0; i < n; i++) buf[i] = spiRec();
+}
+static void spiSend(const uint8_t* buf, uint16_t n) {
+  for (uint16_t i = 0; i < n; i++) spiSend(buf[i]);
+}
+#endif  // USE_SPI_LIB && GRSAKURA
+//------------------------------------------------------------------------------
 // send command and return error code.  Return zero for OK
 uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
   // end read if in partialBlockRead mode
@@ -125,6 +143,9 @@ uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
   if (cmd == CMD8) crc = 0X87;  // correct crc for CMD8 with arg 0X1AA
   spiSend(crc);
 
+  // skip stuff byte for stop read
+  if (cmd == CMD12) spiRec();
+
   // wait for response
   for (uint8_t i = 0; ((status_ = spiRec()) & 0X80) && i != 0XFF; i++)
     ;
@@ -432,9 +453,7 @@ uint8_t Sd2Card::readData(uint32_t block,
     spiRec();
   }
   // transfer data
-  for (uint16_t i = 0; i < count; i++) {
-    dst[i] = spiRec();
-  }
+  spiRec(dst, count);
 #endif  // OPTIMIZE_HARDWARE_SPI
 
   offset_ += count;
@@ -472,6 +491,23 @@ void Sd2Card::readEnd(void) {
   }
 }
 //------------------------------------------------------------------------------
+/** Read one data block in a multiple block read sequence
+ *
+ * \param[out] dst Pointer to the location for the 512 byte block.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readData(uint8_t* dst) {
+  if (!waitStartBlock()) return false;
+
+  // transfer data
+  spiRec(dst, 512);
+  spiRec();  // get first crc byte
+  spiRec();  // get second crc byte
+  return true;
+}
+//------------------------------------------------------------------------------
 /** read CID or CSR register */
 uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf) {
   uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
@@ -492,6 +528,42 @@ uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf) {
   return false;
 }
 //------------------------------------------------------------------------------
+/** Start a read multiple blocks sequence.
+ *
+ * \param[in] blockNumber Address of first block in sequence.
+ *
+ * \note This function is used with readData() and readStop()
+ * for optimized multiple block reads.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readStart(uint32_t blockNumber) {
+  // use address if not SDHC card
+  if (type() != SD_CARD_TYPE_SDHC) blockNumber <<= 9;
+  if (cardCommand(CMD18, blockNumber)) {
+    error(SD_CARD_ERROR_CMD18);
+    chipSelectHigh();
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+/** End a read multiple blocks sequence.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readStop(void) {
+  if (cardCommand(CMD12, 0)) {
+    error(SD_CARD_ERROR_CMD12);
+    chipSelectHigh();
+    return false;
+  }
+  chipSelectHigh();
+  return true;
+}
+//------------------------------------------------------------------------------
 /**
  * Set the SPI clock rate.
  *
@@ -640,9 +712,7 @@ uint8_t Sd2Card::writeData(uint8_t token, const uint8_t* src) {
 
 #else  // OPTIMIZE_HARDWARE_SPI
   spiSend(token);
-  for (uint16_t i = 0; i < 512; i++) {
-    spiSend(src[i]);
-  }
+  spiSend(src, 512);
 #endif  // OPTIMIZE_HARDWARE_SPI
   spiSend(0xff);  // dummy crc
   spiSend(0xff);  // dummy crc
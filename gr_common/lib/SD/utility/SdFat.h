@@ -35,6 +35,32 @@
  */
 #define ALLOW_DEPRECATED_FUNCTIONS 1
 //------------------------------------------------------------------------------
+/**
+ * Number of 512 byte blocks cached for the FAT, directories and file data.
+ * Each kind replaces its own least recently used block, so walking a
+ * cluster chain does not push out the directory entry of an open file.
+ */
+#ifndef SD_CACHE_FAT_BLOCKS
+#define SD_CACHE_FAT_BLOCKS 2
+#endif
+#ifndef SD_CACHE_DIR_BLOCKS
+#define SD_CACHE_DIR_BLOCKS 1
+#endif
+#ifndef SD_CACHE_DATA_BLOCKS
+#define SD_CACHE_DATA_BLOCKS 4  // one per file SD.h can open
+#endif
+/** Total number of blocks in the SdVolume cache */
+#define SD_CACHE_BLOCKS \
+  (SD_CACHE_FAT_BLOCKS + SD_CACHE_DIR_BLOCKS + SD_CACHE_DATA_BLOCKS)
+/**
+ * Runs of contiguous clusters each open file remembers, so seekSet() finds
+ * a cluster without walking the FAT. A file written in one go on a fresh
+ * card is a single run.
+ */
+#ifndef SD_FILE_EXTENTS
+#define SD_FILE_EXTENTS 8
+#endif
+//------------------------------------------------------------------------------
 // forward declaration since SdVolume is used in SdFile
 class SdVolume;
 //==============================================================================
@@ -393,12 +419,20 @@ class SdFile : public Print {
   uint8_t   dirIndex_;      // index of entry in dirBlock 0 <= dirIndex_ <= 0XF
   uint32_t  fileSize_;      // file size in bytes
   uint32_t  firstCluster_;  // first cluster of file
+  uint32_t  markCluster_;   // cluster left by the last seek or zero
+  uint32_t  markIndex_;     // index of markCluster_ in the chain
+  uint8_t   extentCount_;   // runs of contiguous clusters in the map
+  uint32_t  extentEnd_;     // number of chain clusters the map covers
+  uint32_t  extentIndex_[SD_FILE_EXTENTS];    // chain index of each run
+  uint32_t  extentCluster_[SD_FILE_EXTENTS];  // first cluster of each run
   SdVolume* vol_;           // volume where file is located
 
   // private functions
   uint8_t addCluster(void);
   uint8_t addDirCluster(void);
   dir_t* cacheDirEntry(uint8_t action);
+  void extentAdd(uint32_t n, uint32_t cluster);
+  uint32_t extentFind(uint32_t n) const;
   static void (*dateTime_)(uint16_t* date, uint16_t* time);
   static uint8_t make83Name(const char* str, uint8_t* name);
   uint8_t openCachedEntry(uint8_t cacheIndex, uint8_t oflags);
@@ -437,9 +471,13 @@ class SdVolume {
    */
   static uint8_t* cacheClear(void) {
     cacheFlush();
-    cacheBlockNumber_ = 0XFFFFFFFF;
-    return cacheBuffer_.data;
+    cacheSlots_[cacheCurrent_].block = 0XFFFFFFFF;
+    return cacheBuffer_->data;
   }
+  /** \return Number of cache lookups that found the block in the cache. */
+  static uint32_t cacheHits(void) {return cacheHits_;}
+  /** \return Number of cache lookups that had to read the card. */
+  static uint32_t cacheMisses(void) {return cacheMisses_;}
   /**
    * Initialize a FAT volume.  Try partition one first then try super
    * floppy format.
@@ -499,11 +537,25 @@ class SdVolume {
   // value for action argument in cacheRawBlock to indicate cache dirty
   static uint8_t const CACHE_FOR_WRITE = 1;
 
-  static cache_t cacheBuffer_;        // 512 byte cache for device blocks
-  static uint32_t cacheBlockNumber_;  // Logical number of block in the cache
+  // value for kind argument in cacheRawBlock, selects the blocks replaced
+  static uint8_t const CACHE_FAT = 0;
+  static uint8_t const CACHE_DIR = 1;
+  static uint8_t const CACHE_DATA = 2;
+
+  struct cache_slot_t {
+    uint32_t block;   // Logical number of block in the slot
+    uint32_t mirror;  // block number for mirror FAT or zero
+    uint32_t used;    // cacheClock_ at last use
+    uint8_t dirty;    // cacheFlush() will write block if true
+  };
+  static cache_t cacheBlocks_[SD_CACHE_BLOCKS];     // 512 byte device blocks
+  static cache_slot_t cacheSlots_[SD_CACHE_BLOCKS]; // state of each block
+  static cache_t* cacheBuffer_;       // block selected by last cacheRawBlock
+  static uint8_t cacheCurrent_;       // slot of cacheBuffer_
+  static uint32_t cacheClock_;        // counts lookups for LRU replacement
+  static uint32_t cacheHits_;         // lookups found in the cache
+  static uint32_t cacheMisses_;       // lookups read from the card
   static Sd2Card* sdCard_;            // Sd2Card object for cache
-  static uint8_t cacheDirty_;         // cacheFlush() will write block if true
-  static uint32_t cacheMirrorBlock_;  // block number for mirror FAT
 //
   uint32_t allocSearchStart_;   // start cluster for alloc search
   uint8_t blocksPerCluster_;    // cluster size in blocks
@@ -524,10 +576,27 @@ class SdVolume {
            return dataStartBlock_ + ((cluster - 2) << clusterSizeShift_);}
   uint32_t blockNumber(uint32_t cluster, uint32_t position) const {
            return clusterStartBlock(cluster) + blockOfCluster(position);}
+  static uint32_t cacheBlockNumber(void) {
+    return cacheSlots_[cacheCurrent_].block;
+  }
+  static int8_t cacheFind(uint32_t blockNumber);
   static uint8_t cacheFlush(void);
-  static uint8_t cacheRawBlock(uint32_t blockNumber, uint8_t action);
-  static void cacheSetDirty(void) {cacheDirty_ |= CACHE_FOR_WRITE;}
-  static uint8_t cacheZeroBlock(uint32_t blockNumber);
+  static uint8_t cacheFlushRange(uint32_t first, uint32_t count);
+  static void cacheInvalidate(uint32_t first, uint32_t count);
+  static uint8_t cacheRawBlock(uint32_t blockNumber, uint8_t action,
+    uint8_t kind = CACHE_DATA);
+  static void cacheSelect(uint8_t i);
+  static void cacheSetDirty(void) {
+    cacheSlots_[cacheCurrent_].dirty |= CACHE_FOR_WRITE;
+  }
+  // a file is done with the current block, replace it before the
+  // partial blocks of other open files
+  static void cacheRetire(void) {
+    cacheSlots_[cacheCurrent_].used = cacheClock_ - 0X7FFFFFFF;
+  }
+  static uint8_t cacheVictim(uint8_t kind);
+  static uint8_t cacheWriteBack(uint8_t i);
+  static uint8_t cacheZeroBlock(uint32_t blockNumber, uint8_t kind);
   uint8_t chainSize(uint32_t beginCluster, uint32_t* size) const;
   uint8_t fatGet(uint32_t cluster, uint32_t* value) const;
   uint8_t fatPut(uint32_t cluster, uint32_t value);
@@ -540,6 +609,7 @@ class SdVolume {
   }
   uint8_t readBlock(uint32_t block, uint8_t* dst) {
     return sdCard_->readBlock(block, dst);}
+  uint8_t readBlocks(uint32_t block, uint8_t* dst, uint16_t count);
   uint8_t readData(uint32_t block, uint16_t offset,
     uint16_t count, uint8_t* dst) {
       return sdCard_->readData(block, offset, count, dst);
@@ -547,5 +617,6 @@ class SdVolume {
   uint8_t writeBlock(uint32_t block, const uint8_t* dst) {
     return sdCard_->writeBlock(block, dst);
   }
+  uint8_t writeBlocks(uint32_t block, const uint8_t* src, uint16_t count);
 };
 #endif  // SdFat_h
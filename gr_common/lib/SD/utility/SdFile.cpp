@@ -51,7 +51,9 @@ uint8_t SdFile::addDirCluster(void) {
   // zero data in cluster insure first cluster is in cache
   uint32_t block = vol_->clusterStartBlock(curCluster_);
   for (uint8_t i = vol_->blocksPerCluster_; i != 0; i--) {
-    if (!SdVolume::cacheZeroBlock(block + i - 1)) return false;
+    if (!SdVolume::cacheZeroBlock(block + i - 1, SdVolume::CACHE_DIR)) {
+      return false;
+    }
   }
   // Increase directory file size by cluster size
   fileSize_ += 512UL << vol_->clusterSizeShift_;
@@ -61,8 +63,10 @@ uint8_t SdFile::addDirCluster(void) {
 // cache a file's directory entry
 // return pointer to cached entry or null for failure
 dir_t* SdFile::cacheDirEntry(uint8_t action) {
-  if (!SdVolume::cacheRawBlock(dirBlock_, action)) return NULL;
-  return SdVolume::cacheBuffer_.dir + dirIndex_;
+  if (!SdVolume::cacheRawBlock(dirBlock_, action, SdVolume::CACHE_DIR)) {
+    return NULL;
+  }
+  return SdVolume::cacheBuffer_->dir + dirIndex_;
 }
 //------------------------------------------------------------------------------
 /**
@@ -322,10 +326,11 @@ uint8_t SdFile::makeDir(SdFile* dir, const char* dirName) {
 
   // cache block for '.'  and '..'
   uint32_t block = vol_->clusterStartBlock(firstCluster_);
-  if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_WRITE)) return false;
+  if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_WRITE,
+    SdVolume::CACHE_DIR)) return false;
 
   // copy '.' to block
-  memcpy(&SdVolume::cacheBuffer_.dir[0], &d, sizeof(d));
+  memcpy(&SdVolume::cacheBuffer_->dir[0], &d, sizeof(d));
 
   // make entry for '..'
   d.name[1] = '.';
@@ -337,7 +342,7 @@ uint8_t SdFile::makeDir(SdFile* dir, const char* dirName) {
     d.firstClusterHigh = dir->firstCluster_ >> 16;
   }
   // copy '..' to block
-  memcpy(&SdVolume::cacheBuffer_.dir[1], &d, sizeof(d));
+  memcpy(&SdVolume::cacheBuffer_->dir[1], &d, sizeof(d));
 
   // set position after '..'
   curPosition_ = 2 * sizeof(d);
@@ -417,7 +422,7 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
       if (!emptyFound) {
         emptyFound = true;
         dirIndex_ = index;
-        dirBlock_ = SdVolume::cacheBlockNumber_;
+        dirBlock_ = SdVolume::cacheBlockNumber();
       }
       // done if no entries follow
       if (p->name[0] == DIR_NAME_FREE) break;
@@ -444,7 +449,7 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
 
     // use first entry in cluster
     dirIndex_ = 0;
-    p = SdVolume::cacheBuffer_.dir;
+    p = SdVolume::cacheBuffer_->dir;
   }
   // initialize as empty file
   memset(p, 0, sizeof(dir_t));
@@ -512,7 +517,7 @@ uint8_t SdFile::open(SdFile* dirFile, uint16_t index, uint8_t oflag) {
 // open a cached directory entry. Assumes vol_ is initializes
 uint8_t SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag) {
   // location of entry in cache
-  dir_t* p = SdVolume::cacheBuffer_.dir + dirIndex;
+  dir_t* p = SdVolume::cacheBuffer_->dir + dirIndex;
 
   // write or truncate is an error for a directory or read-only file
   if (p->attributes & (DIR_ATT_READ_ONLY | DIR_ATT_DIRECTORY)) {
@@ -520,7 +525,7 @@ uint8_t SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag) {
   }
   // remember location of directory entry on SD
   dirIndex_ = dirIndex;
-  dirBlock_ = SdVolume::cacheBlockNumber_;
+  dirBlock_ = SdVolume::cacheBlockNumber();
 
   // copy first cluster number for directory fields
   firstCluster_ = (uint32_t)p->firstClusterHigh << 16;
@@ -542,6 +547,9 @@ uint8_t SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag) {
   // set to start of file
   curCluster_ = 0;
   curPosition_ = 0;
+  markCluster_ = 0;
+  extentCount_ = 0;
+  extentEnd_ = 0;
 
   // truncate file to zero length if requested
   if (oflag & O_TRUNC) return truncate(0);
@@ -581,6 +589,9 @@ uint8_t SdFile::openRoot(SdVolume* vol) {
   // set to start of file
   curCluster_ = 0;
   curPosition_ = 0;
+  markCluster_ = 0;
+  extentCount_ = 0;
+  extentEnd_ = 0;
 
   // root has no directory entry
   dirBlock_ = 0;
@@ -695,25 +706,56 @@ int16_t SdFile::read(void* buf, uint16_t nbyte) {
           // get next cluster from FAT
           if (!vol_->fatGet(curCluster_, &curCluster_)) return -1;
         }
+        extentAdd(curPosition_ >> (vol_->clusterSizeShift_ + 9), curCluster_);
       }
       block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
     }
     uint16_t n = toRead;
 
+    // whole blocks that follow on the card in one multiple block read
+    if (offset == 0 && toRead >= 1024 && !unbufferedRead()) {
+      uint16_t count = toRead >> 9;
+      uint16_t run = count;
+      if (type_ != FAT_FILE_TYPE_ROOT16) {
+        run = vol_->blocksPerCluster_ - vol_->blockOfCluster(curPosition_);
+        uint32_t index = curPosition_ >> (vol_->clusterSizeShift_ + 9);
+        // extend the run over clusters that are contiguous
+        while (run < count) {
+          uint32_t next;
+          if (!vol_->fatGet(curCluster_, &next)) return -1;
+          if (next != curCluster_ + 1) break;
+          curCluster_ = next;
+          extentAdd(++index, next);
+          run += vol_->blocksPerCluster_;
+        }
+        if (run > count) run = count;
+      }
+      if (run > 1) {
+        // the card must have what the cache holds for these blocks
+        if (!SdVolume::cacheFlushRange(block, run)) return -1;
+        if (!vol_->readBlocks(block, dst, run)) return -1;
+        dst += 512UL * run;
+        curPosition_ += 512UL * run;
+        toRead -= 512 * run;
+        continue;
+      }
+    }
     // amount to be read from current block
     if (n > (512 - offset)) n = 512 - offset;
 
     // no buffering needed if n == 512 or user requests no buffering
     if ((unbufferedRead() || n == 512) &&
-      block != SdVolume::cacheBlockNumber_) {
+      SdVolume::cacheFind(block) < 0) {
       if (!vol_->readData(block, offset, n, dst)) return -1;
       dst += n;
     } else {
       // read block to cache and copy data to caller
-      if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_READ)) return -1;
-      uint8_t* src = SdVolume::cacheBuffer_.data + offset;
+      if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_READ,
+        isDir() ? SdVolume::CACHE_DIR : SdVolume::CACHE_DATA)) return -1;
+      uint8_t* src = SdVolume::cacheBuffer_->data + offset;
       uint8_t* end = src + n;
       while (src != end) *dst++ = *src++;
+      if (offset + n == 512) SdVolume::cacheRetire();
     }
     curPosition_ += n;
     toRead -= n;
@@ -765,7 +807,7 @@ dir_t* SdFile::readDirCache(void) {
   curPosition_ += 31;
 
   // return pointer to entry
-  return (SdVolume::cacheBuffer_.dir + i);
+  return (SdVolume::cacheBuffer_->dir + i);
 }
 //------------------------------------------------------------------------------
 /**
@@ -916,6 +958,41 @@ uint8_t SdFile::rmRfStar(void) {
   return rmDir();
 }
 //------------------------------------------------------------------------------
+// record cluster as number n of the chain if it follows the extent map,
+// contiguous clusters only extend the last extent
+void SdFile::extentAdd(uint32_t n, uint32_t cluster) {
+  if (n != extentEnd_) return;
+  if (extentCount_ != 0) {
+    uint8_t i = extentCount_ - 1;
+    if (cluster == extentCluster_[i] + (n - extentIndex_[i])) {
+      extentEnd_++;
+      return;
+    }
+  }
+  // a full map still serves the clusters it covers
+  if (extentCount_ == SD_FILE_EXTENTS) return;
+  extentIndex_[extentCount_] = n;
+  extentCluster_[extentCount_] = cluster;
+  extentCount_++;
+  extentEnd_++;
+}
+//------------------------------------------------------------------------------
+// return cluster number n of the chain, n must be below extentEnd_
+uint32_t SdFile::extentFind(uint32_t n) const {
+  // binary search for the last extent starting at or before n
+  uint8_t lo = 0;
+  uint8_t hi = extentCount_ - 1;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi + 1) >> 1;
+    if (extentIndex_[mid] <= n) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return extentCluster_[lo] + (n - extentIndex_[lo]);
+}
+//------------------------------------------------------------------------------
 /**
  * Sets a file's position.
  *
@@ -932,26 +1009,43 @@ uint8_t SdFile::seekSet(uint32_t pos) {
     curPosition_ = pos;
     return true;
   }
-  if (pos == 0) {
-    // set position to start of file
-    curCluster_ = 0;
-    curPosition_ = 0;
-    return true;
-  }
   // calculate cluster index for cur and new position
   uint32_t nCur = (curPosition_ - 1) >> (vol_->clusterSizeShift_ + 9);
   uint32_t nNew = (pos - 1) >> (vol_->clusterSizeShift_ + 9);
-
-  if (nNew < nCur || curPosition_ == 0) {
-    // must follow chain from first cluster
-    curCluster_ = firstCluster_;
-  } else {
-    // advance from curPosition
-    nNew -= nCur;
+  uint32_t cluster = 0;
+
+  if (pos != 0 && nNew < extentEnd_) {
+    // the extent map already covers the new cluster
+    cluster = extentFind(nNew);
+  } else if (pos != 0) {
+    // follow chain from the nearest known cluster before the new one
+    uint32_t n = 0;
+    cluster = firstCluster_;
+    if (extentEnd_) {
+      n = extentEnd_ - 1;
+      cluster = extentFind(n);
+    }
+    if (curPosition_ != 0 && nCur <= nNew && nCur > n) {
+      n = nCur;
+      cluster = curCluster_;
+    }
+    if (markCluster_ && markIndex_ <= nNew && markIndex_ > n) {
+      n = markIndex_;
+      cluster = markCluster_;
+    }
+    // clusters past the end of the map are added as they are found
+    extentAdd(n, cluster);
+    for (; n < nNew; n++) {
+      if (!vol_->fatGet(cluster, &cluster)) return false;
+      extentAdd(n + 1, cluster);
+    }
   }
-  while (nNew--) {
-    if (!vol_->fatGet(curCluster_, &curCluster_)) return false;
+  // remember the cluster being left so seeking back does not walk the chain
+  if (curPosition_ != 0 && (pos == 0 || nCur != nNew)) {
+    markIndex_ = nCur;
+    markCluster_ = curCluster_;
   }
+  curCluster_ = cluster;
   curPosition_ = pos;
   return true;
 }
@@ -1089,6 +1183,11 @@ uint8_t SdFile::truncate(uint32_t length) {
   // position to last cluster in truncated file
   if (!seekSet(length)) return false;
 
+  // the remembered clusters may be freed
+  markCluster_ = 0;
+  extentCount_ = 0;
+  extentEnd_ = 0;
+
   if (length == 0) {
     // free all clusters
     if (!vol_->freeChain(firstCluster_)) return false;
@@ -1169,6 +1268,7 @@ size_t SdFile::write(const void* buf, uint16_t nbyte) {
           curCluster_ = next;
         }
       }
+      extentAdd(curPosition_ >> (vol_->clusterSizeShift_ + 9), curCluster_);
     }
     // max space in block
     uint16_t n = 512 - blockOffset;
@@ -1178,29 +1278,58 @@ size_t SdFile::write(const void* buf, uint16_t nbyte) {
 
     // block for data write
     uint32_t block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
-    if (n == 512) {
+
+    // whole blocks in one multiple block write
+    uint16_t count = nToWrite >> 9;
+    uint16_t run = vol_->blocksPerCluster_ - blockOfCluster;
+    if (blockOffset == 0 && count > 1) {
+      uint32_t index = curPosition_ >> (vol_->clusterSizeShift_ + 9);
+      // extend the run over clusters that follow on the card, clusters
+      // added at the end of the chain are linked before the data is sent
+      while (run < count) {
+        uint32_t prev = curCluster_;
+        uint32_t next;
+        if (!vol_->fatGet(prev, &next)) goto writeErrorReturn;
+        if (vol_->isEOC(next)) {
+          if (!addCluster()) goto writeErrorReturn;
+          next = curCluster_;
+          curCluster_ = prev;
+        }
+        if (next != prev + 1) break;
+        curCluster_ = next;
+        extentAdd(++index, next);
+        run += vol_->blocksPerCluster_;
+      }
+    }
+    if (run > count) run = count;
+    if (blockOffset == 0 && run > 1) {
+      // drop cached copies of the blocks being replaced
+      SdVolume::cacheInvalidate(block, run);
+      if (!vol_->writeBlocks(block, src, run)) goto writeErrorReturn;
+      src += 512UL * run;
+      n = 512 * run;
+    } else if (n == 512) {
       // full block - don't need to use cache
       // invalidate cache if block is in cache
-      if (SdVolume::cacheBlockNumber_ == block) {
-        SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
-      }
+      SdVolume::cacheInvalidate(block, 1);
       if (!vol_->writeBlock(block, src)) goto writeErrorReturn;
       src += 512;
     } else {
       if (blockOffset == 0 && curPosition_ >= fileSize_) {
         // start of new block don't need to read into cache
-        if (!SdVolume::cacheFlush()) goto writeErrorReturn;
-        SdVolume::cacheBlockNumber_ = block;
-        SdVolume::cacheSetDirty();
+        if (!SdVolume::cacheZeroBlock(block, SdVolume::CACHE_DATA)) {
+          goto writeErrorReturn;
+        }
       } else {
         // rewrite part of block
         if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_WRITE)) {
           goto writeErrorReturn;
         }
       }
-      uint8_t* dst = SdVolume::cacheBuffer_.data + blockOffset;
+      uint8_t* dst = SdVolume::cacheBuffer_->data + blockOffset;
       uint8_t* end = dst + n;
       while (dst != end) *dst++ = *src++;
+      if (blockOffset + n == 512) SdVolume::cacheRetire();
     }
     nToWrite -= n;
     curPosition_ += n;
@@ -20,12 +20,14 @@
 #include "SdFat.h"
 //------------------------------------------------------------------------------
 // raw block cache
-// init cacheBlockNumber_to invalid SD block number
-uint32_t SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
-cache_t  SdVolume::cacheBuffer_;     // 512 byte cache for Sd2Card
+cache_t  SdVolume::cacheBlocks_[SD_CACHE_BLOCKS];  // blocks for Sd2Card
+SdVolume::cache_slot_t SdVolume::cacheSlots_[SD_CACHE_BLOCKS];
+cache_t* SdVolume::cacheBuffer_ = &SdVolume::cacheBlocks_[0];
+uint8_t  SdVolume::cacheCurrent_ = 0;
+uint32_t SdVolume::cacheClock_ = 0;
+uint32_t SdVolume::cacheHits_ = 0;
+uint32_t SdVolume::cacheMisses_ = 0;
 Sd2Card* SdVolume::sdCard_;          // pointer to SD card object
-uint8_t  SdVolume::cacheDirty_ = 0;  // cacheFlush() will write block if true
-uint32_t SdVolume::cacheMirrorBlock_ = 0;  // mirror  block for second FAT
 //------------------------------------------------------------------------------
 // find a contiguous group of clusters
 uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
@@ -96,42 +98,128 @@ uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
   return true;
 }
 //------------------------------------------------------------------------------
+// return the slot holding blockNumber or -1
+int8_t SdVolume::cacheFind(uint32_t blockNumber) {
+  if (cacheSlots_[cacheCurrent_].block == blockNumber) return cacheCurrent_;
+  for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++) {
+    if (cacheSlots_[i].block == blockNumber) return i;
+  }
+  return -1;
+}
+//------------------------------------------------------------------------------
+// write all dirty blocks, FAT blocks also go to the mirror FAT
 uint8_t SdVolume::cacheFlush(void) {
-  if (cacheDirty_) {
-    if (!sdCard_->writeBlock(cacheBlockNumber_, cacheBuffer_.data)) {
-      return false;
+  for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++) {
+    if (!cacheWriteBack(i)) return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// write dirty blocks in the range so the card holds what the cache holds
+uint8_t SdVolume::cacheFlushRange(uint32_t first, uint32_t count) {
+  for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++) {
+    if ((cacheSlots_[i].block - first) < count) {
+      if (!cacheWriteBack(i)) return false;
     }
-    // mirror FAT tables
-    if (cacheMirrorBlock_) {
-      if (!sdCard_->writeBlock(cacheMirrorBlock_, cacheBuffer_.data)) {
-        return false;
-      }
-      cacheMirrorBlock_ = 0;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// drop cached copies of blocks in the range without writing them
+void SdVolume::cacheInvalidate(uint32_t first, uint32_t count) {
+  for (uint8_t i = 0; i < SD_CACHE_BLOCKS; i++) {
+    if ((cacheSlots_[i].block - first) < count) {
+      cacheSlots_[i].block = 0XFFFFFFFF;
+      cacheSlots_[i].mirror = 0;
+      cacheSlots_[i].dirty = 0;
     }
-    cacheDirty_ = 0;
   }
+}
+//------------------------------------------------------------------------------
+uint8_t SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action,
+  uint8_t kind) {
+  int8_t i = cacheFind(blockNumber);
+  if (i >= 0) {
+    cacheHits_++;
+  } else {
+    cacheMisses_++;
+    i = cacheVictim(kind);
+    if (!cacheWriteBack(i)) return false;
+    cacheSlots_[i].block = 0XFFFFFFFF;
+    if (!sdCard_->readBlock(blockNumber, cacheBlocks_[i].data)) return false;
+    cacheSlots_[i].block = blockNumber;
+  }
+  cacheSelect(i);
+  cacheSlots_[i].dirty |= action;
   return true;
 }
 //------------------------------------------------------------------------------
-uint8_t SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action) {
-  if (cacheBlockNumber_ != blockNumber) {
-    if (!cacheFlush()) return false;
-    if (!sdCard_->readBlock(blockNumber, cacheBuffer_.data)) return false;
-    cacheBlockNumber_ = blockNumber;
+// make slot i the block used through cacheBuffer_
+void SdVolume::cacheSelect(uint8_t i) {
+  cacheCurrent_ = i;
+  cacheBuffer_ = &cacheBlocks_[i];
+  cacheSlots_[i].used = ++cacheClock_;
+}
+//------------------------------------------------------------------------------
+// pick the slot to replace, an empty one or the least recently used
+uint8_t SdVolume::cacheVictim(uint8_t kind) {
+  uint8_t first = 0;
+  uint8_t last = SD_CACHE_FAT_BLOCKS;
+  if (kind == CACHE_DIR) {
+    first = last;
+    last += SD_CACHE_DIR_BLOCKS;
+  } else if (kind == CACHE_DATA) {
+    first = SD_CACHE_FAT_BLOCKS + SD_CACHE_DIR_BLOCKS;
+    last = SD_CACHE_BLOCKS;
+  }
+  uint8_t victim = first;
+  for (uint8_t i = first; i < last; i++) {
+    if (cacheSlots_[i].block == 0XFFFFFFFF) return i;
+    // the clock only runs forward so the difference is the age
+    if ((cacheClock_ - cacheSlots_[i].used) >
+        (cacheClock_ - cacheSlots_[victim].used)) {
+      victim = i;
+    }
+  }
+  return victim;
+}
+//------------------------------------------------------------------------------
+// write slot i if dirty. A FAT block is copied to the mirror FAT here,
+// once per flush instead of once per changed entry.
+uint8_t SdVolume::cacheWriteBack(uint8_t i) {
+  cache_slot_t* s = &cacheSlots_[i];
+  if (s->dirty) {
+    if (!sdCard_->writeBlock(s->block, cacheBlocks_[i].data)) {
+      return false;
+    }
+    // mirror FAT tables
+    if (s->mirror) {
+      if (!sdCard_->writeBlock(s->mirror, cacheBlocks_[i].data)) {
+        return false;
+      }
+      s->mirror = 0;
+    }
+    s->dirty = 0;
   }
-  cacheDirty_ |= action;
   return true;
 }
 //------------------------------------------------------------------------------
 // cache a zero block for blockNumber
-uint8_t SdVolume::cacheZeroBlock(uint32_t blockNumber) {
-  if (!cacheFlush()) return false;
+uint8_t SdVolume::cacheZeroBlock(uint32_t blockNumber, uint8_t kind) {
+  int8_t i = cacheFind(blockNumber);
+  if (i < 0) {
+    i = cacheVictim(kind);
+    if (!cacheWriteBack(i)) return false;
+  }
+  // a replaced FAT block must not be mirrored over this one
+  cacheSlots_[i].mirror = 0;
 
-  // loop take less flash than memset(cacheBuffer_.data, 0, 512);
-  for (uint16_t i = 0; i < 512; i++) {
-    cacheBuffer_.data[i] = 0;
+  // loop take less flash than memset(data, 0, 512);
+  for (uint16_t j = 0; j < 512; j++) {
+    cacheBlocks_[i].data[j] = 0;
   }
-  cacheBlockNumber_ = blockNumber;
+  cacheSlots_[i].block = blockNumber;
+  cacheSelect(i);
   cacheSetDirty();
   return true;
 }
@@ -152,13 +240,11 @@ uint8_t SdVolume::fatGet(uint32_t cluster, uint32_t* value) const {
   if (cluster > (clusterCount_ + 1)) return false;
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
-  if (lba != cacheBlockNumber_) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) return false;
-  }
+  if (!cacheRawBlock(lba, CACHE_FOR_READ, CACHE_FAT)) return false;
   if (fatType_ == 16) {
-    *value = cacheBuffer_.fat16[cluster & 0XFF];
+    *value = cacheBuffer_->fat16[cluster & 0XFF];
   } else {
-    *value = cacheBuffer_.fat32[cluster & 0X7F] & FAT32MASK;
+    *value = cacheBuffer_->fat32[cluster & 0X7F] & FAT32MASK;
   }
   return true;
 }
@@ -175,19 +261,16 @@ uint8_t SdVolume::fatPut(uint32_t cluster, uint32_t value) {
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
 
-  if (lba != cacheBlockNumber_) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) return false;
-  }
+  if (!cacheRawBlock(lba, CACHE_FOR_WRITE, CACHE_FAT)) return false;
   // store entry
   if (fatType_ == 16) {
-    cacheBuffer_.fat16[cluster & 0XFF] = value;
+    cacheBuffer_->fat16[cluster & 0XFF] = value;
   } else {
-    cacheBuffer_.fat32[cluster & 0X7F] = value;
+    cacheBuffer_->fat32[cluster & 0X7F] = value;
   }
-  cacheSetDirty();
 
-  // mirror second FAT
-  if (fatCount_ > 1) cacheMirrorBlock_ = lba + blocksPerFat_;
+  // mirror second FAT when the block is written back
+  if (fatCount_ > 1) cacheSlots_[cacheCurrent_].mirror = lba + blocksPerFat_;
   return true;
 }
 //------------------------------------------------------------------------------
@@ -209,6 +292,29 @@ uint8_t SdVolume::freeChain(uint32_t cluster) {
   return true;
 }
 //------------------------------------------------------------------------------
+// read consecutive blocks with one READ_MULTIPLE_BLOCK command
+uint8_t SdVolume::readBlocks(uint32_t block, uint8_t* dst, uint16_t count) {
+  if (!sdCard_->readStart(block)) return false;
+  for (uint16_t i = 0; i < count; i++, dst += 512) {
+    if (!sdCard_->readData(dst)) {
+      // stop the card sending, errorCode() still tells why
+      sdCard_->readStop();
+      return false;
+    }
+  }
+  return sdCard_->readStop();
+}
+//------------------------------------------------------------------------------
+// write consecutive blocks with one WRITE_MULTIPLE_BLOCK command
+uint8_t SdVolume::writeBlocks(uint32_t block,
+  const uint8_t* src, uint16_t count) {
+  if (!sdCard_->writeStart(block, count)) return false;
+  for (uint16_t i = 0; i < count; i++, src += 512) {
+    if (!sdCard_->writeData(src)) return false;
+  }
+  return sdCard_->writeStop();
+}
+//------------------------------------------------------------------------------
 /**
  * Initialize a FAT volume.
  *
@@ -227,12 +333,14 @@ uint8_t SdVolume::freeChain(uint32_t cluster) {
 uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
   uint32_t volumeStartBlock = 0;
   sdCard_ = dev;
+  // nothing cached belongs to this card yet
+  cacheInvalidate(0, 0XFFFFFFFF);
   // if part == 0 assume super floppy with FAT boot sector in block zero
   // if part > 0 assume mbr volume with partition table
   if (part) {
     if (part > 4)return false;
     if (!cacheRawBlock(volumeStartBlock, CACHE_FOR_READ)) return false;
-    part_t* p = &cacheBuffer_.mbr.part[part-1];
+    part_t* p = &cacheBuffer_->mbr.part[part-1];
     if ((p->boot & 0X7F) !=0  ||
       p->totalSectors < 100 ||
       p->firstSector == 0) {
@@ -242,7 +350,7 @@ uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
     volumeStartBlock = p->firstSector;
   }
   if (!cacheRawBlock(volumeStartBlock, CACHE_FOR_READ)) return false;
-  bpb_t* bpb = &cacheBuffer_.fbs.bpb;
+  bpb_t* bpb = &cacheBuffer_->fbs.bpb;
   if (bpb->bytesPerSector != 512 ||
     bpb->fatCount == 0 ||
     bpb->reservedSectorCount == 0 ||
@@ -291,3 +291,221 @@ void SPIClass::notUsingInterrupt(uint8_t interruptNumber)
   }
 #endif
 }
+
+#ifdef GRSAKURA
+#include "rx63n/interrupt_handlers.h"
+#include "rx63n/util.h"
+
+// DMAC channels for useDma(). Channels 0 and 1 belong to the USB host
+// driver. While DTE is set the channel takes the RSPI0 requests.
+static volatile st_dmac1 *const dmac_channels[] = { NULL, NULL, &DMAC2, &DMAC3 };
+static volatile unsigned char *const dmac_sources[] = { NULL, NULL, &ICU.DMRSR2, &ICU.DMRSR3 };
+
+// SPDR cannot be read or written by byte, so the DMAC moves 32 bit
+// frames. MSB first sends the top byte of a long first, so the bytes
+// are swapped on the way in and out.
+static uint32_t dma_tx_buffer[SPI_DMA_MAX / 4];
+static const uint32_t dma_ones = 0xFFFFFFFF;
+static uint32_t dma_sink;
+
+static int dma_tx = -1;
+static int dma_rx = -1;
+static volatile bool dma_busy = false;
+static void (*dma_callback)(void);
+static uint32_t *dma_rx_buffer;
+static size_t dma_words;
+static bool dma_swap;
+static uint16_t dma_spcmd;
+
+bool SPIClass::useDma(int tx_channel, int rx_channel)
+{
+  if ((tx_channel >= 0 || rx_channel >= 0) &&
+      (tx_channel < 2 || tx_channel > 3 ||
+       rx_channel < 2 || rx_channel > 3 || tx_channel == rx_channel)) {
+    return false;
+  }
+  while (dma_busy) {
+    ;
+  }
+  bool di = isNoInterrupts();
+  noInterrupts();
+  if (dma_rx >= 0) {
+    unsigned int vect = VECT_DMAC_DMAC2I + dma_rx - 2;
+    BCLR(&ICU.IER[vect >> 3].BYTE, vect & 7);
+  }
+  dma_tx = tx_channel;
+  dma_rx = rx_channel;
+  if (dma_rx >= 0) {
+    startModule(MstpIdDMAC);
+    DMAC.DMAST.BYTE = 1;
+
+    volatile st_dmac1 *dmac = dmac_channels[dma_tx];
+    dmac->DMCNT.BYTE = 0;
+    dmac->DMTMD.WORD = 0x2201;  // normal transfer, 32 bits, started by the peripheral
+    dmac->DMINT.BYTE = 0;
+    dmac->DMCSL.BYTE = 0;
+    dmac->DMDAR = (unsigned long)&RSPI0.SPDR;
+    *dmac_sources[dma_tx] = VECT_RSPI0_SPTI0;
+
+    dmac = dmac_channels[dma_rx];
+    dmac->DMCNT.BYTE = 0;
+    dmac->DMTMD.WORD = 0x2201;
+    dmac->DMINT.BYTE = 0x10;    // interrupt when the last frame is in
+    dmac->DMCSL.BYTE = 0;
+    dmac->DMSAR = (unsigned long)&RSPI0.SPDR;
+    *dmac_sources[dma_rx] = VECT_RSPI0_SPRI0;
+
+    unsigned int vect = VECT_DMAC_DMAC2I + dma_rx - 2;
+    ICU.IR[vect].BIT.IR = 0;
+    ICU.IPR[IPR_DMAC_DMAC2I + dma_rx - 2].BIT.IPR = 5;
+    BSET(&ICU.IER[vect >> 3].BYTE, vect & 7);
+    // SPRI0 and SPTI0 go to the DMAC, a stray one to the empty handlers
+    ICU.IPR[IPR_RSPI0_SPRI0].BIT.IPR = 1;
+  }
+  if (!di) {
+    interrupts();
+  }
+  return true;
+}
+
+bool SPIClass::transferBusy(void)
+{
+  return dma_busy;
+}
+
+bool SPIClass::transferAsync(const void *txBuffer, void *rxBuffer,
+                             size_t count, void (*callback)(void))
+{
+  if (dma_rx < 0 || dma_busy || count == 0 || count > SPI_DMA_MAX ||
+      (count & 3) != 0 || ((uintptr_t)rxBuffer & 3) != 0) {
+    return false;
+  }
+  uint16_t spcmd = RSPI0.SPCMD0.WORD;
+  const uint8_t *tx = (const uint8_t *)txBuffer;
+  volatile st_dmac1 *dmac;
+
+  dma_swap = !(spcmd & (1 << 12));
+  dma_words = count / 4;
+  dma_rx_buffer = (uint32_t *)rxBuffer;
+  dma_spcmd = spcmd;
+  dma_callback = callback;
+  dma_busy = true;
+
+  dmac = dmac_channels[dma_tx];
+  if (tx) {
+    for (size_t i = 0; i < dma_words; i++, tx += 4) {
+      if (dma_swap) {
+        dma_tx_buffer[i] = (uint32_t)tx[0] << 24 | (uint32_t)tx[1] << 16 |
+                           (uint32_t)tx[2] << 8 | tx[3];
+      } else {
+        dma_tx_buffer[i] = (uint32_t)tx[3] << 24 | (uint32_t)tx[2] << 16 |
+                           (uint32_t)tx[1] << 8 | tx[0];
+      }
+    }
+    dmac->DMSAR = (unsigned long)dma_tx_buffer;
+    dmac->DMAMD.WORD = 0x8000;  // source incremented, destination fixed
+  } else {
+    dmac->DMSAR = (unsigned long)&dma_ones;
+    dmac->DMAMD.WORD = 0x0000;
+  }
+  dmac->DMCRA = dma_words;
+
+  dmac = dmac_channels[dma_rx];
+  if (rxBuffer) {
+    dmac->DMDAR = (unsigned long)rxBuffer;
+    dmac->DMAMD.WORD = 0x0080;  // source fixed, destination incremented
+  } else {
+    dmac->DMDAR = (unsigned long)&dma_sink;
+    dmac->DMAMD.WORD = 0x0000;
+  }
+  dmac->DMCRA = dma_words;
+
+  bool di = isNoInterrupts();
+  noInterrupts();
+  RSPI0.SPCR.BIT.SPE = 0;
+  RSPI0.SPSR.BYTE = 0xA0;     // clear an overrun
+  RSPI0.SPCMD0.WORD = (spcmd & ~SPI_BIT_MASK) | (SPI_BIT_32 << 8);
+  ICU.IR[VECT_RSPI0_SPRI0].BIT.IR = 0;
+  ICU.IR[VECT_RSPI0_SPTI0].BIT.IR = 0;
+  dmac_channels[dma_rx]->DMCNT.BYTE = 1;
+  dmac_channels[dma_tx]->DMCNT.BYTE = 1;
+  BSET(&ICU.IER[IER_RSPI0_SPRI0].BYTE, 7);
+  BSET(&ICU.IER[IER_RSPI0_SPTI0].BYTE, 0);
+  // the empty transmit buffer starts the first frame
+  RSPI0.SPCR.BYTE |= 0x60;    // SPTIE, SPE
+  if (!di) {
+    interrupts();
+  }
+  return true;
+}
+
+// The receive channel has taken the last frame
+void SPIClass::dmaInterrupt(int channel)
+{
+  if (channel != dma_rx || !dma_busy) {
+    return;
+  }
+  dmac_channels[channel]->DMSTS.BYTE = 0;
+  BCLR(&ICU.IER[IER_RSPI0_SPRI0].BYTE, 7);
+  BCLR(&ICU.IER[IER_RSPI0_SPTI0].BYTE, 0);
+  RSPI0.SPCR.BYTE &= ~0x60;
+  RSPI0.SPCMD0.WORD = dma_spcmd;
+  RSPI0.SPCR.BIT.SPE = 1;
+  ICU.IR[VECT_RSPI0_SPRI0].BIT.IR = 0;
+  ICU.IR[VECT_RSPI0_SPTI0].BIT.IR = 0;
+
+  if (dma_rx_buffer && dma_swap) {
+    for (size_t i = 0; i < dma_words; i++) {
+      dma_rx_buffer[i] = __builtin_bswap32(dma_rx_buffer[i]);
+    }
+  }
+  dma_busy = false;
+  void (*callback)(void) = dma_callback;
+  dma_callback = NULL;
+  if (callback) {
+    callback();
+  }
+}
+
+void SPIClass::transfer(const void *txBuffer, void *rxBuffer, size_t count)
+{
+  const uint8_t *tx = (const uint8_t *)txBuffer;
+  uint8_t *rx = (uint8_t *)rxBuffer;
+
+  // sleeping needs the DMAC interrupt
+  if (!isNoInterrupts()) {
+    while (count >= SPI_DMA_MIN) {
+      size_t n = count > SPI_DMA_MAX ? SPI_DMA_MAX : count & ~3;
+      if (!transferAsync(tx, rx, n, NULL)) {
+        break;
+      }
+      while (true) {
+        noInterrupts();
+        if (!dma_busy) {
+          interrupts();
+          break;
+        }
+        wait();
+      }
+      if (tx) tx += n;
+      if (rx) rx += n;
+      count -= n;
+    }
+  }
+  // the rest byte by byte
+  while (count-- > 0) {
+    uint8_t b = transfer(tx ? *tx++ : 0xFF);
+    if (rx) *rx++ = b;
+  }
+}
+
+void INT_Excep_DMAC_DMAC2I(void)
+{
+  SPIClass::dmaInterrupt(2);
+}
+
+void INT_Excep_DMAC_DMAC3I(void)
+{
+  SPIClass::dmaInterrupt(3);
+}
+#endif //GRSAKURA
@@ -75,9 +75,14 @@
 #define SPI_MODE3 0x3
 
 #define SPI_BIT_8 0x7
+#define SPI_BIT_32 0x2
 
 #define SPI_MODE_MASK 0x0003  // PHA = bit 0, POL = 1
 #define SPI_BIT_MASK 0x0F00  //
+
+// Largest DMAC transfer, and the shortest one worth setting up
+#define SPI_DMA_MAX 512
+#define SPI_DMA_MIN 16
 #endif //GRSAKURA
 
 // define SPI_AVR_EIMSK for AVR boards with external interrupt pins
@@ -338,6 +343,26 @@ public:
     while (!(SPSR & _BV(SPIF))) ;
     *p = SPDR;
   }
+#else
+  // Send count bytes from txBuffer, or 0xFF when it is NULL, and store the
+  // bytes received in rxBuffer unless it is NULL. After useDma() the DMAC
+  // moves the long aligned part and the CPU sleeps until it is done.
+  static void transfer(const void *txBuffer, void *rxBuffer, size_t count);
+  inline static void transfer(void *buf, size_t count) {
+    transfer(buf, buf, count);
+  }
+  // Start a DMAC transfer and return at once. callback, if not NULL, is
+  // called from the DMAC interrupt when it has ended. Returns false if the
+  // DMAC cannot take it: count must be a multiple of 4 up to SPI_DMA_MAX
+  // and rxBuffer long aligned.
+  static bool transferAsync(const void *txBuffer, void *rxBuffer,
+                            size_t count, void (*callback)(void));
+  static bool transferBusy(void);
+  // Transfer with DMAC channel 2 or 3 each way, -1 for none. The receive
+  // channel should have the lower number, it is served first. Call
+  // after begin().
+  static bool useDma(int tx_channel, int rx_channel);
+  static void dmaInterrupt(int channel);
 #endif //GRSAKURA
   // After performing a group of transfers and releasing the chip select
   // signal, this function allows others to access the SPI bus
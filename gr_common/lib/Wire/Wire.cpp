@@ -57,7 +57,7 @@ void (*TwoWire::user_onReceive)(int);
 #else
 // Initialize Class Variables //////////////////////////////////////////////////
 static uint8_t i2c_rxBuffer[8][BUFFER_LENGTH];
-static uint8_t i2c_txBuffer[8][BUFFER_LENGTH];
+static uint8_t i2c_txBuffer[8][WIRE_TX_BUFFER_LENGTH];
 
 static SoftI2cMaster wire(18, 19);
 static const uint8_t g_sci_i2c_channel_table[8] = {0, 0, 2, 6, 8, 1, 3, 5};
@@ -85,6 +85,9 @@ TwoWire::TwoWire(uint8_t channel)
     transmitting = 0;
     wire_channel = channel;
     wire_frequency = 100000;
+    wire_async = false;
+    memset(&wire_xfer, 0, sizeof(wire_xfer));
+    wire_xfer.status = TWI_RX_STATUS_DONE;
 }
 #endif
 
@@ -166,22 +169,17 @@ uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop
           interrupts();
       }
   } else {
-      if (g_sci_i2c_channel_inRepStart[wire_channel] != true) {
-          twi_rx_start(g_sci_i2c_channel_table[wire_channel], address);
-      } else {
-          twi_rx_restart(g_sci_i2c_channel_table[wire_channel], address);
-      }
-      for (int i = 0; i < quantity; i++) {
-          i2c_rxBuffer[wire_channel][i] = twi_rx_read(
-                  g_sci_i2c_channel_table[wire_channel], i == (quantity - 1));
-          read++;
-      }
-      if (sendStop == true) {
-          twi_rx_stop(g_sci_i2c_channel_table[wire_channel]);
-          g_sci_i2c_channel_inRepStart[wire_channel] = false;
-      } else {
-          g_sci_i2c_channel_inRepStart[wire_channel] = true;
-      }
+      waitTransfer();
+      wire_xfer.address = address >> 1;
+      wire_xfer.sendStop = sendStop;
+      wire_xfer.tx = NULL;
+      wire_xfer.txLength = 0;
+      wire_xfer.rx = i2c_rxBuffer[wire_channel];
+      wire_xfer.rxLength = quantity;
+      wire_xfer.callback = NULL;
+      twi_rx_submit(g_sci_i2c_channel_table[wire_channel], &wire_xfer);
+      waitTransfer();
+      read = wire_xfer.rxCount;
   }
 #endif
   // set rx buffer iterator vars
@@ -208,6 +206,8 @@ uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop)
 
 void TwoWire::beginTransmission(uint8_t address)
 {
+  // the tx buffer may still be on the bus
+  waitTransfer();
   // indicate that we are transmitting
   transmitting = 1;
   // set address of targeted slave
@@ -239,6 +239,7 @@ uint8_t TwoWire::endTransmission(uint8_t sendStop)
 {
   // transmit buffer (blocking)
 //  int8_t ret = twi_writeTo(txAddress, txBuffer, txBufferLength, 1, sendStop);
+    uint8_t ret = 0;
     uint8_t address = txAddress;
     address <<= 1;
 
@@ -246,13 +247,19 @@ uint8_t TwoWire::endTransmission(uint8_t sendStop)
         bool di = isNoInterrupts();
         noInterrupts();
 
+        bool ack;
         if (g_sci_i2c_channel_inRepStart[wire_channel] != true) {
-            wire.start(address);
+            ack = wire.start(address);
         } else {
-            wire.restart(address);
+            ack = wire.restart(address);
+        }
+        if (!ack) {
+            ret = TWI_RX_STATUS_NACK_ADDR;
         }
         for (int i = 0; i < txBufferLength; i++) {
-            wire.write(i2c_txBuffer[wire_channel][i]);
+            if (!wire.write(i2c_txBuffer[wire_channel][i]) && ret == 0) {
+                ret = TWI_RX_STATUS_NACK_DATA;
+            }
         }
         if (sendStop == true) {
             wire.stop();
@@ -265,21 +272,17 @@ uint8_t TwoWire::endTransmission(uint8_t sendStop)
         }
 
     } else {
-        if (g_sci_i2c_channel_inRepStart[wire_channel] != true) {
-            twi_rx_start(g_sci_i2c_channel_table[wire_channel], address);
-        } else {
-            twi_rx_restart(g_sci_i2c_channel_table[wire_channel], address);
-        }
-
-        for (int i = 0; i < txBufferLength; i++) {
-            twi_rx_write(g_sci_i2c_channel_table[wire_channel],
-                    i2c_txBuffer[wire_channel][i]);
-        }
-        if (sendStop == true) {
-            twi_rx_stop(g_sci_i2c_channel_table[wire_channel]);
-            g_sci_i2c_channel_inRepStart[wire_channel] = false;
-        } else {
-            g_sci_i2c_channel_inRepStart[wire_channel] = true;
+        wire_xfer.address = txAddress;
+        wire_xfer.sendStop = sendStop;
+        wire_xfer.tx = i2c_txBuffer[wire_channel];
+        wire_xfer.txLength = txBufferLength;
+        wire_xfer.rx = NULL;
+        wire_xfer.rxLength = 0;
+        wire_xfer.callback = NULL;
+        twi_rx_submit(g_sci_i2c_channel_table[wire_channel], &wire_xfer);
+        if (!wire_async) {
+            waitTransfer();
+            ret = wire_xfer.status;
         }
     }
 
@@ -288,8 +291,7 @@ uint8_t TwoWire::endTransmission(uint8_t sendStop)
   txBufferLength = 0;
   // indicate that we are done transmitting
   transmitting = 0;
-  //  return ret;
-  return 0;
+  return ret;
 }
 
 //  This provides backwards compatibility with the original
@@ -308,7 +310,7 @@ size_t TwoWire::write(uint8_t data)
   if(transmitting){
   // in master transmitter mode
     // don't bother if buffer is full
-    if(txBufferLength >= BUFFER_LENGTH){
+    if(txBufferLength >= WIRE_TX_BUFFER_LENGTH){
       setWriteError();
       return 0;
     }
@@ -387,7 +389,7 @@ int TwoWire::peek(void)
 
 void TwoWire::flush(void)
 {
-  // XXX: to be implemented.
+  waitTransfer();
 }
 
 void TwoWire::setFrequency(int freq){
@@ -395,11 +397,52 @@ void TwoWire::setFrequency(int freq){
     if(wire_channel == 0){
         wire.setFrequency(wire_frequency);
     } else {
+        waitTransfer();
         twi_rx_setFrequency(g_sci_i2c_channel_table[wire_channel], wire_frequency);
     }
+}
+
+//  In async mode endTransmission() returns as soon as the transfer is
+//  queued on a hardware channel and the bus drains in the background.
+//  The next beginTransmission(), requestFrom() or flush() waits for it.
+//  The software channel (Wire) is always synchronous.
+void TwoWire::setAsync(bool enable)
+{
+    waitTransfer();
+    wire_async = enable;
+}
+
+//  Queue a caller owned transfer on a hardware channel without waiting.
+//  Returns false for the software channel.
+bool TwoWire::submit(twi_rx_xfer_t* xfer)
+{
+    if (wire_channel == 0) {
+        return false;
+    }
+    return twi_rx_submit(g_sci_i2c_channel_table[wire_channel], xfer);
+}
 
+bool TwoWire::busy(void)
+{
+    if (wire_channel == 0) {
+        return false;
+    }
+    return twi_rx_isBusy(g_sci_i2c_channel_table[wire_channel]);
+}
 
+//  Only needed when transfers are not interrupt driven.
+void TwoWire::poll(void)
+{
+    if (wire_channel != 0) {
+        twi_rx_poll(g_sci_i2c_channel_table[wire_channel]);
+    }
+}
 
+void TwoWire::waitTransfer(void)
+{
+    if (wire_channel != 0) {
+        twi_rx_wait(g_sci_i2c_channel_table[wire_channel], &wire_xfer);
+    }
 }
 
 
@@ -38,6 +38,12 @@ extern "C" {
 #include "utility/I2cMaster.h"
 
 #define BUFFER_LENGTH 32
+// Transmit buffer size. Large enough for a 128 column display row with
+// its cursor commands (max 255). Wire.cpp sizes its buffers with it, so
+// change it only for the whole build, with -D in CFLAGS of the makefile.
+#ifndef WIRE_TX_BUFFER_LENGTH
+#define WIRE_TX_BUFFER_LENGTH 136
+#endif
 
 class TwoWire : public Stream
 {
@@ -54,6 +60,9 @@ class TwoWire : public Stream
     uint8_t transmitting;
     uint8_t wire_channel;
     int wire_frequency;
+    bool wire_async;
+    twi_rx_xfer_t wire_xfer;
+    void waitTransfer(void);
  //   void (*user_onRequest)(void);
  //   void (*user_onReceive)(int);
  //   void onRequestService(void);
@@ -80,6 +89,10 @@ class TwoWire : public Stream
     virtual int peek(void);
     virtual void flush(void);
     void setFrequency(int freq);
+    void setAsync(bool enable);
+    bool submit(twi_rx_xfer_t* xfer);
+    bool busy(void);
+    void poll(void);
 //    void onReceive( void (*)(int) );
 //    void onRequest( void (*)(void) );
 
@@ -41,6 +41,7 @@ SoftI2cMaster::SoftI2cMaster(uint8_t sdaPin, uint8_t sclPin) {
   sclPin_ = sclPin;
   pinMode(sclPin_, OUTPUT_OPENDRAIN);
   digitalWrite(sclPin_, HIGH);
+  setFrequency(TWI_FREQ);
 }
 //------------------------------------------------------------------------------
 /** Read a byte and send Ack if more reads follow else Nak to terminate read.
@@ -55,13 +56,13 @@ uint8_t SoftI2cMaster::read(uint8_t last) {
   // make sure pull-up enabled
   pinMode(sdaPin_, INPUT_PULLUP);
   // read byte
-  delayMicroseconds(10); //TODO
+  delayMicroseconds(delayClock);
   for (uint8_t i = 0; i < 8; i++) {
     // don't change this loop unless you verify the change with a scope
     b <<= 1;
-    delayMicroseconds(3); //TODO
+    delayMicroseconds(delayBit_);
     digitalWrite(sclPin_, HIGH);
-    delayMicroseconds(15); //TODO
+    delayMicroseconds(delaySample_);
     if (digitalRead(sdaPin_)) b |= 1;
     digitalWrite(sclPin_, LOW);
   }
@@ -125,40 +126,63 @@ bool SoftI2cMaster::write(uint8_t data) {
 
   for (uint8_t m = 0x80; m != 0; m >>= 1) {
     // don't change this loop unless you verify the change with a scope
-    delayMicroseconds(3); //TODO
-    delayMicroseconds(3); //TODO
+    delayMicroseconds(2 * delayBit_);
     digitalWrite(sdaPin_, !((m & data) == 0));
-    delayMicroseconds(3); //TODO
+    delayMicroseconds(delayBit_);
     digitalWrite(sclPin_, HIGH);
-    delayMicroseconds(3); //TODO
+    delayMicroseconds(delayBit_);
     digitalWrite(sclPin_, LOW);
   }
 
   // get Ack or Nak
   pinMode(sdaPin_, INPUT_PULLUP);
-  delayMicroseconds(3); //TODO
+  delayMicroseconds(delayBit_);
   digitalWrite(sclPin_, HIGH);
-  delayMicroseconds(3); //TODO
+  delayMicroseconds(delayBit_);
   uint8_t rtn = digitalRead(sdaPin_);
   digitalWrite(sclPin_, LOW);
   pinMode(sdaPin_, OUTPUT_OPENDRAIN);
   digitalWrite(sdaPin_, HIGH);
-  delayMicroseconds(20); //TODO
+  delayMicroseconds(delayAck_);
   return rtn == 0;
 }
 //------------------------------------------------------------------------------
+/**
+ * Bit timing for each bus mode in microseconds.  The 100 kHz row keeps the
+ * delays measured on GR-SAKURA; pin toggling takes the rest of the period.
+ */
+static const struct {
+  int freq;
+  uint8_t clock;   // start, stop and Ack/Nak phases
+  uint8_t bit;     // data setup and SCL high while writing
+  uint8_t sample;  // SCL high before sampling SDA while reading
+  uint8_t ack;     // bus release after the Ack/Nak bit
+} softI2cTiming[] = {
+  {  100000, 10, 3, 15, 20 },  // standard mode
+  {  400000,  2, 1,  2,  2 },  // fast mode
+  { 1000000,  1, 0,  0,  0 },  // fast mode plus
+};
+//------------------------------------------------------------------------------
 /**
  * I2C の周波数(待ち時間)を設定する
  *
- * 引数: freq は周波数(Hz)
+ * 引数: freq は周波数(Hz)。100kHz, 400kHz, 1MHz のうち freq を超えない
+ *       最も速いタイミングを選ぶ
  *
  * 戻値: なし
  */
 void SoftI2cMaster::setFrequency(int freq)
 {
-    // TODO to implement
-    if (freq > 0) {
-//        delayClock = (1000 + (2 * freq) - 1) / (2 * freq);
-        delayClock = 10;
+    if (freq <= 0) {
+        return;
+    }
+    uint8_t i = 0;
+    while (i + 1 < sizeof(softI2cTiming) / sizeof(softI2cTiming[0])
+            && softI2cTiming[i + 1].freq <= freq) {
+        i++;
     }
+    delayClock = softI2cTiming[i].clock;
+    delayBit_ = softI2cTiming[i].bit;
+    delaySample_ = softI2cTiming[i].sample;
+    delayAck_ = softI2cTiming[i].ack;
 }
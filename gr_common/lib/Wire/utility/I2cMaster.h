@@ -111,6 +111,9 @@ class SoftI2cMaster : public I2cMasterBase {
   void setFrequency(int freq);
  private:
   int delayClock;
+  uint8_t delayBit_;
+  uint8_t delaySample_;
+  uint8_t delayAck_;
   uint8_t sdaPin_;
   uint8_t sclPin_;
 };
@@ -29,6 +29,7 @@
 #include "math.h"
 
 #include "rx63n/iodefine.h"
+#include "rx63n/interrupt_handlers.h"
 
 void twi_rx_init(uint8_t channel, int freq){
     typedef struct {
@@ -94,7 +95,6 @@ void twi_rx_init(uint8_t channel, int freq){
 
     twi_rx_setFrequency(channel, freq);
 
-    SCIx_I2C_SIMR1_BYTE(channel) = 0x19;
     SCIx_I2C_SIMR2_BYTE(channel) = 0x23;
 
 }
@@ -182,17 +182,37 @@ bool twi_rx_write(uint8_t channel, uint8_t data) {
 }
 
 //------------------------------------------------------------------------------
+/**
+ * SDA output delay for each bus mode.  The delay is counted in cycles of
+ * the baud rate generator clock, so it shrinks with the bit period.
+ */
+static const struct {
+    int maxFreq;
+    uint8_t simr1;  // IICDL[4:0] << 3 | IICM
+} twiRxTiming[] = {
+    {  100000, 0x19 },  // standard mode, IICDL = 3
+    {  400000, 0x11 },  // fast mode, IICDL = 2
+    { 1000000, 0x09 },  // fast mode plus, IICDL = 1
+};
+
 /**
  * Set frequency.
  *
- * \param[in] data The byte to send.
- *
- * \return The value true, 1, if the slave returned an Ack or false for Nak.
+ * \param[in] freq The bus clock in Hz.  The divider is rounded so the
+ * actual clock does not exceed freq; with PCLK at 48 MHz 400 kHz gives
+ * 375 kHz and 1 MHz gives 750 kHz.
  */
 void twi_rx_setFrequency(uint8_t channel, int freq) {
     if (freq > (PCLK / ((32 << (2 * 3)) * 256)) && freq <= (PCLK / 32)) {
         int n;
         int N;
+        int t = 0;
+        uint8_t scr = SCIx_I2C_SCR_BYTE(channel);
+        while (t + 1 < (int)(sizeof(twiRxTiming) / sizeof(twiRxTiming[0]))
+                && freq > twiRxTiming[t].maxFreq) {
+            t++;
+        }
+        SCIx_I2C_SCR_BYTE(channel) = 0x00; // SMR, BRR and SIMR1 need TE = RE = 0
         for (n = 0; n <= 3; n++) {
             N = ((PCLK + (32 << (2 * n)) * freq - 1) / ((32 << (2 * n)) * freq)) - 1;
             if (N >= 0 && N <= 255) {
@@ -201,5 +221,346 @@ void twi_rx_setFrequency(uint8_t channel, int freq) {
                 break;
             }
         }
+        SCIx_I2C_SIMR1_BYTE(channel) = twiRxTiming[t].simr1;
+        SCIx_I2C_SCR_BYTE(channel) = scr;
+    }
+}
+
+//==============================================================================
+// Queued transfer engine.
+//
+// Each channel works through a list of twi_rx_xfer_t.  Every bus event
+// (start/stop condition generated, byte acknowledged, byte received) moves
+// the current transfer one step.  The events come from the SCI interrupts
+// when TWI_RX_USE_INTERRUPT is set, or from twi_rx_poll() otherwise.
+//------------------------------------------------------------------------------
+enum {
+    TWI_RX_STATE_IDLE,
+    TWI_RX_STATE_START,     // waiting for the start condition
+    TWI_RX_STATE_ADDRESS,   // waiting for the address Ack
+    TWI_RX_STATE_WRITE,     // waiting for a data Ack
+    TWI_RX_STATE_READ,      // waiting for a data byte
+    TWI_RX_STATE_READ_ACK,  // waiting for the Ack/Nak to go out
+    TWI_RX_STATE_STOP,      // waiting for the stop condition
+};
+
+typedef struct {
+    twi_rx_xfer_t* volatile head;
+    twi_rx_xfer_t* tail;
+    uint16_t index;
+    uint8_t state;
+    uint8_t result;         // status reported once the stop is done
+    bool reading;
+    bool inRepStart;
+    bool irqEnabled;
+} TwiRxChannel;
+
+static TwiRxChannel g_twi_rx_channel[TWI_RX_CHANNELS];
+
+#define TWI_RX_VECT(a) (VECT_SCI0_RXI0 + a * SCI_I2C_IR_OFFSET)
+
+static void twi_rx_enableIrq(uint8_t channel, bool enable) {
+#if TWI_RX_USE_INTERRUPT
+    int v = TWI_RX_VECT(channel);
+    int i;
+    if (enable) {
+        ICU.IPR[v].BIT.IPR = TWI_RX_INTERRUPT_PRIORITY;
+    }
+    for (i = v; i < v + 3; i++) {
+        if (enable) {
+            BSET(&ICU.IER[i >> 3].BYTE, i & 7);
+        } else {
+            BCLR(&ICU.IER[i >> 3].BYTE, i & 7);
+        }
+    }
+#endif
+    g_twi_rx_channel[channel].irqEnabled = enable;
+}
+
+static void twi_rx_sendByte(uint8_t channel, uint8_t data) {
+    SCIx_I2C_SIMR3_BYTE(channel) &= 0b11110111; // Clear STIF
+    SCIx_I2C_SIMR3_BYTE(channel) &= 0b00001111; // Output SDA and SCL
+    SCIx_I2C_TDR_BYTE(channel) = data;
+}
+
+static void twi_rx_sendStart(uint8_t channel) {
+    TwiRxChannel* c = &g_twi_rx_channel[channel];
+    if (c->inRepStart) {
+        SCIx_I2C_SIMR3_BYTE(channel) &= 0b11110111; // Clear STIF
+        SCIx_I2C_SCR_BYTE(channel) = 0xB4; // Enable TIE and TEIE
+        SCIx_I2C_SIMR3_BYTE(channel) = 0x52; // Generate restart condition
+    } else {
+        SCIx_I2C_SCR_BYTE(channel) = 0xB4; // Enable TIE and TEIE
+        SCIx_I2C_SIMR3_BYTE(channel) = 0x51; // Generate start condition
     }
+    c->state = TWI_RX_STATE_START;
 }
+
+static void twi_rx_readByte(uint8_t channel) {
+    TwiRxChannel* c = &g_twi_rx_channel[channel];
+    SCIx_I2C_SIMR2_BYTE(channel) &= 0b11011111;
+    SCIx_I2C_SCR_BYTE(channel) |= 0b01000000; // Enable RIE
+    if (c->index + 1 >= c->head->rxLength) {
+        SCIx_I2C_SIMR2_BYTE(channel) |= 0b00100000; // Nak the last byte
+    }
+    SCIx_I2C_TDR_BYTE(channel) = 0xFF; // dummy write
+    c->state = TWI_RX_STATE_READ;
+}
+
+static void twi_rx_beginNext(uint8_t channel) {
+    TwiRxChannel* c = &g_twi_rx_channel[channel];
+    twi_rx_xfer_t* x = c->head;
+    if (x == 0) {
+        c->state = TWI_RX_STATE_IDLE;
+        twi_rx_enableIrq(channel, false);
+        return;
+    }
+    x->status = TWI_RX_STATUS_BUSY;
+    x->rxCount = 0;
+    c->index = 0;
+    c->reading = x->txLength == 0 && x->rxLength != 0;
+    twi_rx_sendStart(channel);
+}
+
+static void twi_rx_complete(uint8_t channel, uint8_t status) {
+    TwiRxChannel* c = &g_twi_rx_channel[channel];
+    twi_rx_xfer_t* x = c->head;
+    c->head = x->next;
+    if (c->head == 0) {
+        c->tail = 0;
+    }
+    x->next = 0;
+    x->status = status;
+    if (x->callback) {
+        x->callback(x);
+    }
+    twi_rx_beginNext(channel);
+}
+
+static void twi_rx_finish(uint8_t channel, uint8_t status) {
+    TwiRxChannel* c = &g_twi_rx_channel[channel];
+    if (status != TWI_RX_STATUS_DONE || c->head->sendStop) {
+        c->result = status;
+        SCIx_I2C_SIMR3_BYTE(channel) = 0x54; // Generate stop condition
+        c->state = TWI_RX_STATE_STOP;
+        return;
+    }
+    c->inRepStart = true;
+    twi_rx_complete(channel, status);
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Start or stop condition generated.
+ *
+ * \return The value true if the event belonged to a queued transfer.
+ */
+bool twi_rx_sti(uint8_t channel) {
+    TwiRxChannel* c;
+    twi_rx_xfer_t* x;
+    if (channel >= TWI_RX_CHANNELS) {
+        return false;
+    }
+    c = &g_twi_rx_channel[channel];
+    x = c->head;
+    if (!c->irqEnabled || x == 0) {
+        return false;
+    }
+    if (c->state == TWI_RX_STATE_START) {
+        twi_rx_sendByte(channel, (x->address << 1) | (c->reading ? 1 : 0));
+        c->state = TWI_RX_STATE_ADDRESS;
+    } else if (c->state == TWI_RX_STATE_STOP) {
+        SCIx_I2C_SIMR3_BYTE(channel) = 0xF0;
+        c->inRepStart = false;
+        twi_rx_complete(channel, c->result);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Byte received.
+ *
+ * \return The value true if the event belonged to a queued transfer.
+ */
+bool twi_rx_rxi(uint8_t channel) {
+    TwiRxChannel* c;
+    twi_rx_xfer_t* x;
+    if (channel >= TWI_RX_CHANNELS) {
+        return false;
+    }
+    c = &g_twi_rx_channel[channel];
+    x = c->head;
+    if (!c->irqEnabled || x == 0) {
+        return false;
+    }
+    if (c->state == TWI_RX_STATE_READ) {
+        x->rx[c->index++] = SCIx_I2C_RDR_BYTE(channel);
+        x->rxCount = c->index;
+        c->state = TWI_RX_STATE_READ_ACK;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Byte transmitted and Ack/Nak cycle finished.
+ *
+ * \return The value true if the event belonged to a queued transfer.
+ */
+bool twi_rx_txi(uint8_t channel) {
+    TwiRxChannel* c;
+    twi_rx_xfer_t* x;
+    bool nak;
+    if (channel >= TWI_RX_CHANNELS) {
+        return false;
+    }
+    c = &g_twi_rx_channel[channel];
+    x = c->head;
+    if (!c->irqEnabled || x == 0) {
+        return false;
+    }
+    nak = (SCIx_I2C_SISR_BYTE(channel) & 0b00000001) != 0;
+    switch (c->state) {
+    case TWI_RX_STATE_ADDRESS:
+        if (nak) {
+            twi_rx_finish(channel, TWI_RX_STATUS_NACK_ADDR);
+            break;
+        }
+        c->index = 0;
+        if (c->reading) {
+            twi_rx_readByte(channel);
+            break;
+        }
+        // fall through
+    case TWI_RX_STATE_WRITE:
+        if (nak && c->state == TWI_RX_STATE_WRITE) {
+            twi_rx_finish(channel, TWI_RX_STATUS_NACK_DATA);
+        } else if (c->index < x->txLength) {
+            twi_rx_sendByte(channel, x->tx[c->index++]);
+            c->state = TWI_RX_STATE_WRITE;
+        } else if (x->rxLength != 0) {
+            // Restart in read direction.
+            c->reading = true;
+            c->inRepStart = true;
+            twi_rx_sendStart(channel);
+        } else {
+            twi_rx_finish(channel, TWI_RX_STATUS_DONE);
+        }
+        break;
+    case TWI_RX_STATE_READ_ACK:
+        if (c->index < x->rxLength) {
+            twi_rx_readByte(channel);
+        } else {
+            twi_rx_finish(channel, TWI_RX_STATUS_DONE);
+        }
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Queue a transfer.  Returns immediately; the transfer is started at once
+ * if the channel is idle.
+ *
+ * \param[in] xfer The transfer.  It must not already be queued.
+ *
+ * \return The value true if the transfer was queued.
+ */
+bool twi_rx_submit(uint8_t channel, twi_rx_xfer_t* xfer) {
+    TwiRxChannel* c;
+    bool di;
+    if (channel >= TWI_RX_CHANNELS || xfer == 0) {
+        return false;
+    }
+    c = &g_twi_rx_channel[channel];
+    xfer->next = 0;
+    xfer->rxCount = 0;
+    xfer->status = TWI_RX_STATUS_QUEUED;
+
+    di = isNoInterrupts();
+    noInterrupts();
+    if (c->head == 0) {
+        c->head = xfer;
+        c->tail = xfer;
+        twi_rx_enableIrq(channel, true);
+        twi_rx_beginNext(channel);
+    } else {
+        c->tail->next = xfer;
+        c->tail = xfer;
+    }
+    if (!di) {
+        interrupts();
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/** \return The value true while a queued transfer is on the bus. */
+bool twi_rx_isBusy(uint8_t channel) {
+    return channel < TWI_RX_CHANNELS && g_twi_rx_channel[channel].head != 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Move the current transfer along by checking the interrupt request flags.
+ * Needed when TWI_RX_USE_INTERRUPT is zero or interrupts are masked.
+ */
+void twi_rx_poll(uint8_t channel) {
+    bool di;
+    if (!twi_rx_isBusy(channel)) {
+        return;
+    }
+    di = isNoInterrupts();
+    noInterrupts();
+    if (SCIx_I2C_IR_TEIE_BYTE(channel)) {
+        SCIx_I2C_IR_TEIE_BYTE(channel) = 0;
+        twi_rx_sti(channel);
+    }
+    if (SCIx_I2C_IR_RIE_BYTE(channel)) {
+        SCIx_I2C_IR_RIE_BYTE(channel) = 0;
+        twi_rx_rxi(channel);
+    }
+    if (SCIx_I2C_IR_TIE_BYTE(channel)) {
+        SCIx_I2C_IR_TIE_BYTE(channel) = 0;
+        twi_rx_txi(channel);
+    }
+    if (!di) {
+        interrupts();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Wait for a queued transfer to finish.
+ *
+ * \return The final status of the transfer.
+ */
+uint8_t twi_rx_wait(uint8_t channel, twi_rx_xfer_t* xfer) {
+    while (xfer->status & TWI_RX_STATUS_QUEUED) {
+#if TWI_RX_USE_INTERRUPT
+        if (isNoInterrupts()) {
+            twi_rx_poll(channel);
+        }
+#else
+        twi_rx_poll(channel);
+#endif
+    }
+    return xfer->status;
+}
+
+//------------------------------------------------------------------------------
+// SCI transmit end interrupts signal start/stop condition generation in
+// simple I2C mode.  RXI and TXI are shared with HardwareSerial and are
+// forwarded from there.
+
+void INT_Excep_SCI0_TEI0(void) { twi_rx_sti(0); }
+void INT_Excep_SCI1_TEI1(void) { twi_rx_sti(1); }
+void INT_Excep_SCI2_TEI2(void) { twi_rx_sti(2); }
+void INT_Excep_SCI3_TEI3(void) { twi_rx_sti(3); }
+void INT_Excep_SCI5_TEI5(void) { twi_rx_sti(5); }
+void INT_Excep_SCI6_TEI6(void) { twi_rx_sti(6); }
+void INT_Excep_SCI8_TEI8(void) { twi_rx_sti(8); }
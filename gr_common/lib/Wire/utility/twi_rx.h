@@ -55,6 +55,41 @@
 #define SCIx_I2C_IR_TIE_BYTE(a)  *((volatile uint8_t*)&ICU.IR[215 + a * SCI_I2C_IR_OFFSET] )
 #define SCIx_I2C_IR_TEIE_BYTE(a)  *((volatile uint8_t*)&ICU.IR[216 + a * SCI_I2C_IR_OFFSET] )
 
+/** Non-zero to complete queued transfers from the SCI interrupts. */
+#ifndef TWI_RX_USE_INTERRUPT
+#define TWI_RX_USE_INTERRUPT 1
+#endif
+/** Interrupt priority level of the SCI I2C interrupts. */
+#define TWI_RX_INTERRUPT_PRIORITY 3
+/** Number of SCI units the transfer engine can drive, SCI0 to SCI8. */
+#define TWI_RX_CHANNELS 9
+
+/** Transfer status values. */
+#define TWI_RX_STATUS_DONE      0
+#define TWI_RX_STATUS_NACK_ADDR 2
+#define TWI_RX_STATUS_NACK_DATA 3
+#define TWI_RX_STATUS_QUEUED    0x80
+#define TWI_RX_STATUS_BUSY      0x81
+
+/**
+ * A queued I2C transfer.  Up to txLength bytes are written, then after a
+ * repeated start up to rxLength bytes are read.  Either length may be zero.
+ * The structure and both buffers must stay valid until the status is
+ * no longer TWI_RX_STATUS_QUEUED or TWI_RX_STATUS_BUSY.
+ */
+typedef struct twi_rx_xfer {
+    uint8_t address;                /**< 7 bit slave address */
+    bool sendStop;                  /**< false to keep the bus for a restart */
+    const uint8_t* tx;
+    uint16_t txLength;
+    uint8_t* rx;
+    uint16_t rxLength;
+    volatile uint16_t rxCount;      /**< bytes read so far */
+    volatile uint8_t status;
+    void (*callback)(struct twi_rx_xfer*);  /**< called from the ISR, or NULL */
+    struct twi_rx_xfer* next;
+} twi_rx_xfer_t;
+
 //------------------------------------------------------------------------------
 void twi_rx_init(uint8_t channel, int freq);
 uint8_t twi_rx_read(uint8_t channel, uint8_t last);
@@ -64,4 +99,12 @@ void twi_rx_stop(uint8_t channel);
 bool twi_rx_write(uint8_t channel, uint8_t b);
 void twi_rx_setFrequency(uint8_t channel, int freq);
 
+bool twi_rx_submit(uint8_t channel, twi_rx_xfer_t* xfer);
+bool twi_rx_isBusy(uint8_t channel);
+void twi_rx_poll(uint8_t channel);
+uint8_t twi_rx_wait(uint8_t channel, twi_rx_xfer_t* xfer);
+bool twi_rx_rxi(uint8_t channel);
+bool twi_rx_txi(uint8_t channel);
+bool twi_rx_sti(uint8_t channel);
+
 #endif  // HARDWARE_I2C_MASTER_H
@@ -601,11 +601,14 @@ void INT_Excep_DMAC_DMAC0I(void){ }
 // DMAC DMAC1I
 void INT_Excep_DMAC_DMAC1I(void){ }
 
-// DMAC DMAC2I
-void INT_Excep_DMAC_DMAC2I(void){ }
-
-// DMAC DMAC3I
-void INT_Excep_DMAC_DMAC3I(void){ }
+/**
+ * Moved to lib/SPI/SPI.cpp.
+ */
+//// DMAC DMAC2I
+//void INT_Excep_DMAC_DMAC2I(void){ }
+//
+//// DMAC DMAC3I
+//void INT_Excep_DMAC_DMAC3I(void){ }
 
 // EXDMAC EXDMAC0I
 void INT_Excep_EXDMAC_EXDMAC0I(void){ }
@@ -622,8 +625,8 @@ void INT_Excep_EXDMAC_EXDMAC1I(void){ }
 //// SCI0_TXI0
 //void INT_Excep_SCI0_TXI0(void){ }
 
-// SCI0_TEI0
-void INT_Excep_SCI0_TEI0(void){ }
+// SCI0_TEI0 : Moved to lib/Wire/utility/twi_rx.c
+//void INT_Excep_SCI0_TEI0(void){ }
 
 //// SCI1_RXI1
 //void INT_Excep_SCI1_RXI1(void){ }
@@ -631,8 +634,8 @@ void INT_Excep_SCI0_TEI0(void){ }
 //// SCI1_TXI1
 //void INT_Excep_SCI1_TXI1(void){ }
 
-// SCI1_TEI1
-void INT_Excep_SCI1_TEI1(void){ }
+// SCI1_TEI1 : Moved to lib/Wire/utility/twi_rx.c
+//void INT_Excep_SCI1_TEI1(void){ }
 
 /**
  * MOD EK 25/09/13 : Moved to core/serial.cpp for serial testing.
@@ -643,8 +646,8 @@ void INT_Excep_SCI1_TEI1(void){ }
 //// SCI2_TXI2
 //void INT_Excep_SCI2_TXI2(void){ }
 
-// SCI2_TEI2
-void INT_Excep_SCI2_TEI2(void){ }
+// SCI2_TEI2 : Moved to lib/Wire/utility/twi_rx.c
+//void INT_Excep_SCI2_TEI2(void){ }
 
 /**
  * MOD Oka 23/05/14 : Moved to core/serial.cpp
@@ -656,8 +659,8 @@ void INT_Excep_SCI2_TEI2(void){ }
 // SCI3_TXI3
 //void INT_Excep_SCI3_TXI3(void){ }
 
-// SCI3_TEI3
-void INT_Excep_SCI3_TEI3(void){ }
+// SCI3_TEI3 : Moved to lib/Wire/utility/twi_rx.c
+//void INT_Excep_SCI3_TEI3(void){ }
 
 // SCI4_RXI4
 void INT_Excep_SCI4_RXI4(void){ }
@@ -678,8 +681,8 @@ void INT_Excep_SCI4_TEI4(void){ }
 // SCI5_TXI5
 //void INT_Excep_SCI5_TXI5(void){ }
 
-// SCI5_TEI5
-void INT_Excep_SCI5_TEI5(void){ }
+// SCI5_TEI5 : Moved to lib/Wire/utility/twi_rx.c
+//void INT_Excep_SCI5_TEI5(void){ }
 
 /**
  * MOD Oka 27/04/14 : Moved to core/serial.cpp
@@ -691,8 +694,8 @@ void INT_Excep_SCI5_TEI5(void){ }
 // SCI6_TXI6
 //void INT_Excep_SCI6_TXI6(void){ }
 
-// SCI6_TEI6
-void INT_Excep_SCI6_TEI6(void){ }
+// SCI6_TEI6 : Moved to lib/Wire/utility/twi_rx.c
+//void INT_Excep_SCI6_TEI6(void){ }
 
 // SCI7_RXI7
 void INT_Excep_SCI7_RXI7(void){ }
@@ -713,8 +716,8 @@ void INT_Excep_SCI7_TEI7(void){ }
 // SCI8_TXI8
 //void INT_Excep_SCI8_TXI8(void){ }
 
-// SCI8_TEI8
-void INT_Excep_SCI8_TEI8(void){ }
+// SCI8_TEI8 : Moved to lib/Wire/utility/twi_rx.c
+//void INT_Excep_SCI8_TEI8(void){ }
 
 // SCI9_RXI9
 void INT_Excep_SCI9_RXI9(void){ }
@@ -30,6 +30,12 @@ do { \
   __asm __volatile("clrpsw i\n"); \
 } while (0)
 
+// Sleep until the next interrupt. Interrupts are enabled by the instruction.
+#define wait() \
+do { \
+  __asm __volatile("wait\n"); \
+} while (0)
+
 #define isNoInterrupts() \
 ({ \
   bool ret; \
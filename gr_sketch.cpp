@@ -22,20 +22,57 @@
 #include <mruby/proc.h>
 #include <mruby/compile.h>
 #include <mruby/string.h>
+#include <mruby/gc.h>
 
+/* Console on the USB CDC port instead of Serial1, the USB keyboard is left out */
+// #define ENABLE_USB_CONSOLE
+#ifndef ENABLE_USB_CONSOLE
 /* USB Keyboard support */
 #include "Keyboard.h"
+#endif
+/* Key input from keyboard and Serial */
+#include "Input.h"
+/* Parse a continued block only when the scanner says it may be complete */
+#include "BlockScan.h"
+/* Line editor with history */
+#define ENABLE_READLINE
+#include "Editor.h"
 /* SSD1306 OLED support */
 #include "Display.h"
-
-#ifndef DISPLAY_H
-/* use Serial instead of stdout */
-#define stdout_putc(c)           { Serial.write(c); }
-#define stdout_write(s, len)     { Serial.write(s, len); }
-#define stdout_print(s)          { Serial.print(s); }
-#define stdout_println(s)        { Serial.println(s); }
-#define handle_backspace()       // do nothing
+/* Buffered output to Serial and the display */
+#include "Output.h"
+/* Heap for mruby on the free RAM */
+#include "Heap.h"
+/* load and require for .mrb files in ROM or on SD */
+#include "Loader.h"
+#ifdef LOADER_H
+#include <SD.h>
+#endif
+/* SD card blocks by DMAC 2 and 3, Serial then transmits by interrupt */
+// #define ENABLE_SD_DMA
+#ifdef ENABLE_SD_DMA
+#include <SPI.h>
+#endif
+/* Script run before the prompt, in ROM or on SD */
+#define AUTORUN_FILE "autorun.mrb"
+/* Restore the interpreter from SD after system_reboot(), needs Heap.h */
+// #define ENABLE_SNAPSHOT
+#include "Snapshot.h"
+/* "paste" command for long scripts, the sender is paced with XON/XOFF */
+#define ENABLE_PASTE
+#define PASTE_BUFFER_SIZE (16 * 1024)
+/* With the USB console, output goes to the USB port straight from the
+ * output buffer, without the copy in the transmit buffer of Serial */
+#ifdef ENABLE_USB_CONSOLE
+#define ENABLE_USB_OUTPUT
+/* ms a transfer may wait for a host that does not read the port */
+#define USB_OUTPUT_TIMEOUT 100
 #endif
+#ifdef ENABLE_USB_OUTPUT
+#include "usb_hal.h"
+#include "usb_cdc.h"
+#endif
+
 
 static void
 p(mrb_state *mrb, mrb_value obj, int prompt)
@@ -201,6 +238,174 @@ is_code_block_open(struct mrb_parser_state *parser)
   return code_block_open;
 }
 
+/* Garbage collection after each evaluation
+ *   REPL_GC_FULL      full GC after every line
+ *   REPL_GC_ADAPTIVE  incremental GC steps when the heap has grown,
+ *                     full GC only past a high-water mark of live objects
+ */
+#define REPL_GC_FULL      0
+#define REPL_GC_ADAPTIVE  1
+
+#define REPL_GC_POLICY       REPL_GC_ADAPTIVE
+#define REPL_GC_HIGH_WATER   4000   /* initial high-water mark */
+#define REPL_GC_STEP_GROWTH  256    /* new objects that start a GC cycle */
+#define REPL_GC_MAX_STEPS    32     /* incremental steps per line */
+
+static size_t gc_high_water = REPL_GC_HIGH_WATER;
+static size_t gc_last_live = 0;
+static unsigned long gc_full_count = 0;
+static unsigned long gc_step_count = 0;
+#ifdef HEAP_H
+static size_t parser_arena_line = 0;  /* arena bytes of the last parse */
+#endif
+
+static void
+repl_gc(mrb_state *mrb)
+{
+#if REPL_GC_POLICY == REPL_GC_FULL
+  mrb_full_gc(mrb);
+  gc_full_count++;
+#else
+  if (mrb->gc.live > gc_high_water) {
+    mrb_full_gc(mrb);
+    gc_full_count++;
+    /* the session really holds this many objects, so do not
+       collect fully again until the heap has doubled */
+    if (mrb->gc.live * 2 > gc_high_water) {
+      gc_high_water = mrb->gc.live * 2;
+    }
+  }
+  else if (mrb->gc.live > gc_last_live + REPL_GC_STEP_GROWTH ||
+           mrb->gc.state != MRB_GC_STATE_ROOT) {
+    /* run a bounded part of a cycle while waiting for input */
+    for (int i = 0; i < REPL_GC_MAX_STEPS; i++) {
+      mrb_incremental_gc(mrb);
+      gc_step_count++;
+      if (mrb->gc.state == MRB_GC_STATE_ROOT) break;
+    }
+  }
+  gc_last_live = mrb->gc.live;
+#endif
+}
+
+static void
+print_gc_stat(mrb_state *mrb)
+{
+  stdout_print("live objects: ");
+  stdout_println((int)mrb->gc.live);
+  stdout_print("high-water: ");
+  stdout_println((int)gc_high_water);
+  stdout_print("full GC: ");
+  stdout_println((int)gc_full_count);
+  stdout_print("GC steps: ");
+  stdout_println((int)gc_step_count);
+#ifdef HEAP_H
+  struct heap_stat st;
+  heap_stat(&st);
+  stdout_print("heap used: ");
+  stdout_print((int)st.used);
+  stdout_print(" / ");
+  stdout_println((int)st.total);
+  stdout_print("heap peak: ");
+  stdout_println((int)st.peak);
+  stdout_print("pool: ");
+  stdout_print((int)st.pool_pages);
+  stdout_print(" pages, ");
+  stdout_print((int)st.pool_free);
+  stdout_println(" bytes free");
+  stdout_print("free: ");
+  stdout_print((int)st.free);
+  stdout_print(" in ");
+  stdout_print((int)st.free_blocks);
+  stdout_println(" blocks");
+  stdout_print("largest free: ");
+  stdout_println((int)st.largest_free);
+  /* share of the free bytes that a single allocation cannot use */
+  stdout_print("fragmentation: ");
+  stdout_print(st.free ? (int)(100 - st.largest_free * 100 / st.free) : 0);
+  stdout_println("%");
+  stdout_print("failed allocations: ");
+  stdout_println((int)st.failures);
+  stdout_print("parser arena: ");
+  stdout_print((int)parser_arena_line);
+  stdout_print(" bytes last line, peak ");
+  stdout_print((int)st.arena_peak);
+  stdout_print(", ");
+  stdout_print((int)st.arena_spills);
+  stdout_println(" spilled");
+#endif
+}
+
+#ifdef ENABLE_USB_OUTPUT
+/* Transfers of usb_output() */
+static struct {
+  unsigned long transfers;
+  unsigned long bytes;      // bytes sent
+  unsigned long dropped;    // bytes lost while the cable was out
+  unsigned long busy_us;    // time transfers were in flight
+} usb_output_stat;
+#endif
+
+static void
+print_io_stat(void)
+{
+  struct output_stat st;
+  output_stat(&st);
+  stdout_print("output: ");
+  stdout_print((int)st.written);
+  stdout_print(" bytes, waited ");
+  stdout_print((int)st.waited);
+  stdout_println(" ms");
+  for (int i = 0; i < st.sinks; i++) {
+    stdout_print("  sink ");
+    stdout_print(i);
+    stdout_print(": ");
+    stdout_print((int)st.drained[i]);
+    stdout_println(" bytes");
+  }
+#ifdef ENABLE_USB_OUTPUT
+  unsigned long busy_ms = usb_output_stat.busy_us / 1000;
+  stdout_print("usb: ");
+  stdout_print((int)usb_output_stat.transfers);
+  stdout_print(" transfers, ");
+  stdout_print((int)usb_output_stat.bytes);
+  stdout_print(" bytes in ");
+  stdout_print((int)busy_ms);
+  stdout_print(" ms, ");
+  stdout_print(busy_ms ? (int)(usb_output_stat.bytes / busy_ms * 1000 / 1024) : 0);
+  stdout_print(" KB/s, dropped ");
+  stdout_println((int)usb_output_stat.dropped);
+#endif
+  stdout_print("input dropped: ");
+  stdout_println((int)input_dropped());
+  stdout_print("serial overruns: ");
+  stdout_println((int)Serial.overruns());
+#ifdef LOADER_H
+  stdout_print("sd cache: ");
+  stdout_print((int)SdVolume::cacheHits());
+  stdout_print(" hits, ");
+  stdout_print((int)SdVolume::cacheMisses());
+  stdout_println(" misses");
+#endif
+}
+
+#ifdef LOADER_H
+static void
+print_libs(void)
+{
+  for (int i = 0; i < loader_count(); i++) {
+    const struct loader_info *info = loader_get_info(i);
+    stdout_print(info->name);
+    stdout_print(info->rom ? " (ROM) " : " (SD) ");
+    stdout_print((int)info->size);
+    stdout_print(" bytes, RAM ");
+    stdout_print((int)info->ram);
+    stdout_print(", in place ");
+    stdout_println((int)info->in_place);
+  }
+}
+#endif
+
 /* Print a short remark for the user */
 static void
 print_hint(void)
@@ -209,9 +414,23 @@ print_hint(void)
   stdout_println("  commands:");
   stdout_println("  quit, exit  system reboot");
   stdout_println("  help        show this screen");
+  stdout_println("  gcstat      show heap statistics");
+  stdout_println("  iostat      show console statistics");
+#ifdef ENABLE_PASTE
+  stdout_println("  paste       run a pasted script, end with Ctrl-D");
+#endif
+#ifdef LOADER_H
+  stdout_println("  libs        show loaded .mrb files");
+#endif
 }
 
-#ifndef ENABLE_READLINE
+#ifdef ENABLE_READLINE
+static void
+editor_output(const char *s, int len)
+{
+  stdout_write(s, len);
+}
+#else
 /* Print the command line prompt of the REPL */
 static void
 print_cmdline(int code_block_open)
@@ -276,27 +495,20 @@ int ai;
 unsigned int stack_keep = 0;
 struct RClass *krn;
 
-void
-setup() {
-  Serial.begin(115200);
-  while (!Serial);
-
-#ifdef KEYBOARD_H
-  setup_keyboard();
-#endif
-#ifdef DISPLAY_H
-  setup_display();
-#endif
-
-  /* new interpreter instance */
+/* Create the interpreter and the REPL's methods */
+static void
+open_interpreter(void)
+{
+#ifdef HEAP_H
+  mrb = mrb_open_allocf(heap_allocf, NULL);
+#else
   mrb = mrb_open();
+#endif
   if (mrb == NULL) {
     stdout_println("Invalid mrb interpreter, exiting mirb");
     exit(EXIT_FAILURE);
   }
 
-  print_hint();
-
   cxt = mrbc_context_new(mrb);
   cxt->capture_errors = TRUE;
   cxt->lineno = 1;
@@ -308,65 +520,249 @@ setup() {
   mrb_define_method(mrb, krn, "p", my_p, MRB_ARGS_REQ(1));
   mrb_define_method(mrb, krn, "print", my_print, MRB_ARGS_REQ(1));
   mrb_define_method(mrb, krn, "puts", my_puts, MRB_ARGS_REQ(1));
+#ifdef LOADER_H
+  setup_loader(mrb);
+#endif
 }
 
-static char
-getchar_from_serial(void)
+#ifdef ENABLE_SNAPSHOT
+/* REPL variables that point into the mruby heap */
+struct repl_roots {
+  mrb_state *mrb;
+  mrbc_context *cxt;
+  int ai;
+};
+
+/* Only a warm boot restores, a power-on reset always starts afresh.
+ * C code run by mrbgems at init time is not repeated. */
+static mrb_bool
+restore_interpreter(void)
 {
-  int key;
+  struct repl_roots roots;
 
-  while (true) {
+  if (!snapshot_warm_boot() || !snapshot_restore(&roots, sizeof(roots))) {
+    return FALSE;
+  }
+  mrb = roots.mrb;
+  cxt = roots.cxt;
+  ai = roots.ai;
+  krn = mrb->kernel_module;
+  return TRUE;
+}
 
-#ifdef DEBUG
-    digitalWrite(PIN_LED0, HIGH);
-    delay(50);
-    digitalWrite(PIN_LED0, LOW);
-    delay(50);
+static void
+save_interpreter(void)
+{
+  struct repl_roots roots = { mrb, cxt, ai };
+
+  snapshot_save(&roots, sizeof(roots));
+}
 #endif
 
-#ifdef KEYBOARD_H
-    keyboard_task();
+#if defined(LOADER_H) && defined(AUTORUN_FILE)
+static void
+autorun(void)
+{
+  if (loader_run(mrb, AUTORUN_FILE) && mrb->exc) {
+    p(mrb, mrb_obj_value(mrb->exc), 0);
+    mrb->exc = 0;
+  }
+  mrb_gc_arena_restore(mrb, ai);
+}
+#endif
 
-    key = get_last_key();
-    if (key > 0) {
+#ifdef ENABLE_PASTE
+/* Bytes of echo queued in front of XOFF while pasting */
+#define PASTE_SERIAL_QUEUE 64
+static mrb_bool paste_mode = FALSE;
+#endif
 
-      // Backspace (temporary code)
-      if (key == 127 || key == 8) {
-    		if (char_index > 0) {
-          char_index--;
-          Serial.print("\b \b");
-          handle_backspace();
-        }
-        continue;
-    	}
-      break;
+#ifdef ENABLE_USB_OUTPUT
+/* Output sink for the USB port. A span of the output buffer goes to the
+ * bulk IN pipe as it is and stays in the buffer until the transfer is done.
+ * The callback comes from the USB interrupt while the buffer belongs to the
+ * main loop, so it only notes the end, and the next call returns the span
+ * to move the tail and starts the next one. */
+static volatile bool usb_output_busy = false;
+static volatile USB_ERR usb_output_err;
+static volatile unsigned long usb_output_end;
+static size_t usb_output_len = 0;
+static unsigned long usb_output_start;
+
+static void
+usb_output_done(USB_ERR err)
+{
+  usb_output_err = err;
+  usb_output_end = micros();
+  usb_output_busy = false;
+}
+
+static size_t
+usb_output(const uint8_t *buf, size_t len)
+{
+  size_t done = 0;
+
+  if (usb_output_busy) {
+    if (!USBCDC_IsConnected()) {
+      /* pulling the cable releases the transfer without the callback */
+      usb_output_done(USB_ERR_NOT_CONNECTED);
+    } else if (micros() - usb_output_start >= USB_OUTPUT_TIMEOUT * 1000UL) {
+      /* a terminal that is open but not reading would stop every writer,
+       * the HAL calls usb_output_done() with USB_ERR_CANCEL */
+      USBHAL_Bulk_IN_Cancel();
+      if (usb_output_busy) {
+        return 0;
+      }
+    } else {
+      return 0;
     }
+  }
+  if (usb_output_len > 0) {
+    done = usb_output_len;
+    usb_output_len = 0;
+    if (usb_output_err == USB_ERR_OK) {
+      usb_output_stat.transfers++;
+      usb_output_stat.bytes += done;
+    } else {
+      usb_output_stat.dropped += done;
+    }
+    usb_output_stat.busy_us += usb_output_end - usb_output_start;
+    buf += done;
+    len -= done;
+  }
+  if (len == 0) {
+    return done;
+  }
+  if (!USBCDC_IsConnected()) {
+    usb_output_stat.dropped += len;
+    return done + len;
+  }
+#ifdef ENABLE_PASTE
+  if (paste_mode && len > PASTE_SERIAL_QUEUE) {
+    /* XOFF from serial_flow() waits for one transfer at most */
+    len = PASTE_SERIAL_QUEUE;
+  }
+#endif
+  usb_output_len = len;
+  usb_output_start = micros();
+  usb_output_busy = true;
+  if (USBCDC_Write_Async(len, buf, usb_output_done) != USB_ERR_OK) {
+    usb_output_busy = false;
+    usb_output_len = 0;
+  }
+  return done;
+}
+#else
+/* Output sink for Serial, takes what fits in its transmit buffer */
+static size_t
+serial_output(const uint8_t *buf, size_t len)
+{
+  size_t n = Serial.availableForWrite();
+
+#ifdef ENABLE_PASTE
+  if (paste_mode) {
+    /* keep the queue short, or XOFF leaves too late to stop the sender */
+    size_t queued = Serial.txCapacity() - n;
+    n = queued < PASTE_SERIAL_QUEUE ? PASTE_SERIAL_QUEUE - queued : 0;
+  }
+#endif
+  if (n > len) {
+    n = len;
+  }
+  return n ? Serial.write(buf, n) : 0;
+}
 #endif
 
-    if (Serial.available() > 0) {
-      key = Serial.read();
-      DEBUG_PRINT("Serial.read", key);
+void
+setup() {
+  /* keys go to the input ring, the receive buffer only holds what the hook refuses */
+  Serial.setBufferSize(16, SERIAL_BUFFER_SIZE);
+  Serial.begin(115200);
+  while (!Serial);
+#ifdef ENABLE_SD_DMA
+  SPI.begin();
+  SPI.useDma(3, 2);   /* transmit 3, receive 2 */
+#elif !defined(ENABLE_USB_CONSOLE)
+  Serial.useDma(2);   /* Serial1, transmit with DMAC channel 2, keys still come by interrupt */
+#endif
+#ifdef ENABLE_USB_OUTPUT
+  output_add_sink(usb_output);
+#else
+  output_add_sink(serial_output);
+#endif
 
-      // Backspace (temporary code)
-      if (key == 127 || key == 8) {
-    		if (char_index > 0) {
-          char_index--;
-          Serial.print("\b \b");
-          handle_backspace();
-        }
-        continue;
-    	}
-      // Cursor (temporary code)
-      if (key == 27) {
-        // temporarily, negrect cursor key
-        while (Serial.available() > 0) {
-          key = Serial.read();
-        }
-        continue;
-      }
+#ifdef KEYBOARD_H
+  setup_keyboard();
+#endif
+#ifdef ENABLE_USB_CONSOLE
+  setup_input(0);   /* USB CDC */
+#else
+  setup_input(1);   /* Serial1 */
+#endif
+#ifdef DISPLAY_H
+  setup_display();
+  output_add_sink(display_output);
+#endif
+#ifdef ENABLE_READLINE
+#ifdef DISPLAY_H
+  setup_editor(editor_output, display_columns());
+#else
+  setup_editor(editor_output, 80);
+#endif
+#endif
 
-      break;
+  /* new interpreter instance */
+#ifdef HEAP_H
+  setup_heap();
+#endif
+#ifdef ENABLE_SNAPSHOT
+  if (!restore_interpreter())
+#endif
+  {
+    open_interpreter();
+#ifdef ENABLE_SNAPSHOT
+    save_interpreter();
+#endif
+  }
+
+  print_hint();
+
+#if defined(LOADER_H) && defined(AUTORUN_FILE)
+  autorun();
+#endif
+}
+
+#ifndef ENABLE_READLINE
+static char
+getchar_from_serial(void)
+{
+  int key;
+
+  while (true) {
+    key = input_getc();
+    DEBUG_PRINT("input_getc", key);
+
+    // Backspace (temporary code)
+    if (key == 127 || key == 8) {
+      if (char_index > 0) {
+        char_index--;
+        stdout_print("\b \b");
+      }
+      continue;
+    }
+    // Cursor (temporary code)
+    if (key == 27) {
+      // skip escape sequences up to the final byte until they are handled
+      key = input_getc();
+      if (key == '[' || key == 'O') {
+        do {
+          key = input_getc();
+        } while (key < 0x40 || key > 0x7e);
+      }
+      continue;
     }
+
+    break;
   }
 
   if (key == 13) {
@@ -377,12 +773,129 @@ getchar_from_serial(void)
   stdout_putc(key);
   return key;
 }
+#endif
+
+#ifdef ENABLE_PASTE
+/* Send XOFF or XON to Serial, from the main loop like the echo */
+static bool
+serial_flow(bool stop)
+{
+  if (Serial.availableForWrite() == 0) {
+    return false;
+  }
+  Serial.write(stop ? 0x13 : 0x11);
+  return true;
+}
+
+/* Read a script up to Ctrl-D into a buffer from the mruby heap, *nlines
+ * gets its number of lines. The echo skips the display, which cannot keep
+ * up with a paste. */
+static char *
+read_paste(int *nlines)
+{
+  char *buf;
+  size_t len = 0;
+  unsigned long lines = 0, start = 0, last = 0;
+  mrb_bool overflow = FALSE;
+  int c, prev = 0;
+
+  buf = (char *)mrb_malloc_simple(mrb, PASTE_BUFFER_SIZE);
+  if (buf == NULL) {
+    stdout_println("paste: not enough memory");
+    return NULL;
+  }
+  stdout_println("paste mode, Ctrl-D to run, Ctrl-C to cancel");
+  output_flush();
+#ifdef DISPLAY_H
+  output_mute(display_output, TRUE);
+#endif
+  paste_mode = TRUE;
+  input_flow_control(serial_flow);
+
+  while ((c = input_getc()) != 4 && c != 3) {
+    if (len == 0 && lines == 0) {
+      start = millis();
+    }
+    /* a line may end with CR, LF or both */
+    if (c == '\n' && prev == '\r') {
+      prev = c;
+      continue;
+    }
+    prev = c;
+    if (c == '\r') {
+      c = '\n';
+    }
+    /* room for a final newline and the terminator */
+    if (len < PASTE_BUFFER_SIZE - 2) {
+      buf[len++] = c;
+    }
+    else {
+      overflow = TRUE;
+    }
+    if (c == '\n') {
+      lines++;
+      last = millis();
+      stdout_print("\r\n");
+    }
+    else {
+      stdout_putc(c);
+    }
+  }
+
+  input_flow_control(NULL);
+  paste_mode = FALSE;
+  output_flush();
+#ifdef DISPLAY_H
+  output_mute(display_output, FALSE);
+#endif
+
+  if (c == 3 || overflow) {
+    stdout_println(c == 3 ? "^C" : "paste: script too long");
+    mrb_free(mrb, buf);
+    return NULL;
+  }
+  if (len > 0 && buf[len - 1] != '\n') {
+    buf[len++] = '\n';
+    lines++;
+  }
+  buf[len] = '\0';
+  *nlines = (int)lines;
+
+  stdout_print((int)lines);
+  stdout_print(" lines, ");
+  stdout_print((int)len);
+  stdout_print(" bytes in ");
+  stdout_print((int)(last - start));
+  stdout_print(" ms");
+  if (last > start) {
+    stdout_print(", ");
+    stdout_print((int)(lines * 1000 / (last - start)));
+    stdout_print(" lines/s");
+  }
+  stdout_println("");
+  return buf;
+}
+#endif
 
 void
 loop() {
   while (TRUE) {
     char *utf8;
-
+    char *code = ruby_code;
+    int lines = 1;    /* lines of code, for cxt->lineno */
+
+#ifdef ENABLE_READLINE
+    int len = editor_readline(code_block_open ? "* " : "> ",
+                              last_code_line, sizeof(last_code_line) - 1);
+    if (len < 0) {
+      input_canceled = 1;
+    }
+    else {
+      editor_add_history(last_code_line);
+      char_index = len;
+      last_char = '\n';
+    }
+#else
     print_cmdline(code_block_open);
 
     char_index = 0;
@@ -395,6 +908,7 @@ loop() {
       }
       last_code_line[char_index++] = last_char;
     }
+#endif
     if (input_canceled) {
       ruby_code[0] = '\0';
       last_code_line[0] = '\0';
@@ -421,6 +935,7 @@ done:
       strcat(ruby_code, last_code_line);
     }
     else {
+      block_scan_reset();
       if (check_keyword(last_code_line, "quit") || check_keyword(last_code_line, "exit")) {
         break;
       }
@@ -428,14 +943,53 @@ done:
         print_hint();
         continue;
       }
+      else if (check_keyword(last_code_line, "gcstat")) {
+        print_gc_stat(mrb);
+        continue;
+      }
+      else if (check_keyword(last_code_line, "iostat")) {
+        print_io_stat();
+        continue;
+      }
+#ifdef LOADER_H
+      else if (check_keyword(last_code_line, "libs")) {
+        print_libs();
+        continue;
+      }
+#endif
+#ifdef ENABLE_PASTE
+      else if (check_keyword(last_code_line, "paste")) {
+        /* the whole script is parsed at once */
+        code = read_paste(&lines);
+        if (code == NULL) {
+          continue;
+        }
+        goto parse;
+      }
+#endif
 
       strcpy(ruby_code, last_code_line);
     }
 
-    utf8 = mrb_utf8_from_locale(ruby_code, -1);
+    block_scan_line(last_code_line);
+    if (block_surely_open()) {
+      /* no need to parse yet */
+      code_block_open = TRUE;
+      cxt->lineno++;
+      continue;
+    }
+
+#ifdef ENABLE_PASTE
+parse:
+#endif
+    utf8 = mrb_utf8_from_locale(code, -1);
     if (!utf8) abort();
 
     /* parse code */
+#ifdef HEAP_H
+    /* the parser's pages come from an arena that is rewound after use */
+    heap_arena_begin();
+#endif
     parser = mrb_parser_new(mrb);
     if (parser == NULL) {
       stdout_println("create parser state error");
@@ -445,8 +999,27 @@ done:
     parser->send = utf8 + strlen(utf8);
     parser->lineno = cxt->lineno;
     mrb_parser_parse(parser, cxt);
+#ifdef HEAP_H
+    heap_arena_end();
+    parser_arena_line = heap_arena_used();
+    DEBUG_PRINT("parser arena", parser_arena_line);
+#endif
     code_block_open = is_code_block_open(parser);
     mrb_utf8_free(utf8);
+#ifdef ENABLE_PASTE
+    if (code != ruby_code) {
+      mrb_free(mrb, code);
+      if (code_block_open) {
+        /* no more lines will come for a pasted script */
+        stdout_println("paste: unexpected end of script");
+        code_block_open = FALSE;
+        mrb_parser_free(parser);
+        mrb_gc_arena_restore(mrb, ai);
+        cxt->lineno += lines;
+        continue;
+      }
+    }
+#endif
 
     if (code_block_open) {
       /* no evaluation of code */
@@ -493,13 +1066,14 @@ done:
       mrb_gc_arena_restore(mrb, ai);
     }
     mrb_parser_free(parser);
-    cxt->lineno++;
+    cxt->lineno += lines;
 
-    mrb_full_gc(mrb);
+    repl_gc(mrb);
   }
 
   mrbc_context_free(mrb, cxt);
   mrb_close(mrb);
 
+  output_flush();
   system_reboot(REBOOT_USERAPP);
 }
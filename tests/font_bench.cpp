@@ -0,0 +1,77 @@
+/*
+ * Font rendering of SSD1306Ascii
+ *
+ * Writes every glyph of each font in SSD1306Ascii/src/fonts at 1X and
+ * 2X through three builds of the library: summing the width table as
+ * before INCLUDE_GLYPH_TABLE, with the glyph table, and with the table
+ * and INCLUDE_GLYPH_CACHE. The bytes sent to the display must be the
+ * same for all three, the time per character is printed.
+ */
+#include <stdio.h>
+#include "fonts/allFonts.h"
+#include "font_bench.h"
+
+#define PASSES 20
+
+static const struct {
+  const char *name;
+  const uint8_t *font;
+} fonts[] = {
+#define FONT(_n) { #_n, _n },
+#include "font_list.h"
+#undef FONT
+};
+
+static const struct {
+  const char *name;
+  font_render_fn *render;
+} builds[] = {
+  { "sum", font_render_sum },
+  { "table", font_render_table },
+  { "cache", font_render_cache },
+};
+
+#define NBUILDS (sizeof(builds) / sizeof(builds[0]))
+
+static int failures;
+
+int
+main(void)
+{
+  double total[2][NBUILDS] = {};
+
+  printf("%-20s %3s %6s %8s %8s %8s  ns/char\n", "font", "mag", "chars",
+         builds[0].name, builds[1].name, builds[2].name);
+  for (size_t f = 0; f < sizeof(fonts) / sizeof(fonts[0]); f++) {
+    for (uint8_t mag = 1; mag <= 2; mag++) {
+      struct font_run run[NBUILDS];
+      for (size_t b = 0; b < NBUILDS; b++) {
+        builds[b].render(fonts[f].font, mag, PASSES, &run[b]);
+        total[mag - 1][b] += run[b].seconds;
+        if (b && (run[b].hash != run[0].hash || run[b].bytes != run[0].bytes ||
+                  run[b].chars != run[0].chars)) {
+          printf("FAIL: %s %dX, %s sends other bytes than %s\n", fonts[f].name,
+                 mag, builds[b].name, builds[0].name);
+          failures++;
+        }
+      }
+      printf("%-20s %2dX %6u", fonts[f].name, mag, (unsigned)run[0].chars);
+      for (size_t b = 0; b < NBUILDS; b++) {
+        printf(" %8.1f", run[b].chars ? run[b].seconds * 1e9 / run[b].chars : 0.0);
+      }
+      printf("\n");
+    }
+  }
+  for (int m = 0; m < 2; m++) {
+    printf("total %dX:", m + 1);
+    for (size_t b = 0; b < NBUILDS; b++) {
+      printf(" %s %.2f ms", builds[b].name, total[m][b] * 1e3);
+    }
+    printf("\n");
+  }
+  if (failures) {
+    printf("checks failed\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,24 @@
+/* write() of SSD1306Ascii built three ways, see font_render.cpp */
+#ifndef font_bench_h
+#define font_bench_h
+
+#include <stdint.h>
+
+struct font_run {
+  uint32_t hash;                // FNV-1a of every byte and mode sent
+  uint32_t bytes;               // bytes sent to the display
+  uint32_t chars;               // characters written
+  double seconds;               // time spent in write()
+};
+
+typedef void font_render_fn(const uint8_t *font, uint8_t mag, int passes,
+                            struct font_run *run);
+
+// INCLUDE_GLYPH_TABLE 0, the width table summed for each glyph as before
+font_render_fn font_render_sum;
+// INCLUDE_GLYPH_TABLE 1
+font_render_fn font_render_table;
+// INCLUDE_GLYPH_TABLE 1 and INCLUDE_GLYPH_CACHE 1
+font_render_fn font_render_cache;
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * One build of SSD1306Ascii for font_bench
+ *
+ * The makefile compiles this file once for each setting of
+ * INCLUDE_GLYPH_TABLE and INCLUDE_GLYPH_CACHE, with FONT_RENDER naming
+ * the entry point and SSD1306Ascii renamed so the builds can be linked
+ * together.
+ */
+#include <time.h>
+#include "SSD1306Ascii.cpp"
+#include "font_bench.h"
+
+namespace {
+
+// The display, every byte sent to it goes into the hash
+class BenchDisplay : public SSD1306Ascii {
+public:
+  void begin(void) {
+    m_hash = 2166136261u;
+    m_bytes = 0;
+    init(&Adafruit128x64);
+  }
+  uint32_t m_hash;
+  uint32_t m_bytes;
+protected:
+  void writeDisplay(uint8_t b, uint8_t mode) {
+    m_hash = (m_hash ^ b) * 16777619u;
+    m_hash = (m_hash ^ mode) * 16777619u;
+    m_bytes++;
+  }
+};
+
+double
+seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Start a new line when the character does not fit, wrap to the top.
+// charWidth() leaves the magnification out for proportional fonts, scale
+// puts it back.
+void
+put(BenchDisplay &oled, uint8_t c, uint8_t scale, struct font_run *run)
+{
+  if (oled.col() + scale*(oled.charWidth(c) + 1) > oled.displayWidth()) {
+    uint8_t row = oled.row() + oled.fontRows();
+    if (row + oled.fontRows() > oled.displayRows()) row = 0;
+    oled.setCursor(0, row);
+  }
+  run->chars += oled.write(c);
+}
+
+}  // namespace
+
+// Every glyph of the font once, then a line with few distinct characters
+// as the console shows them, passes times over
+void
+FONT_RENDER(const uint8_t *font, uint8_t mag, int passes, struct font_run *run)
+{
+  static const char line[] = "x = 12 * x + 21";
+  static BenchDisplay oled;
+  oled.begin();
+  oled.setFont(font);
+  if (mag == 2) {
+    oled.set2X();
+  } else {
+    oled.set1X();
+  }
+  uint8_t first = readFontByte(font + FONT_FIRST_CHAR);
+  uint8_t count = readFontByte(font + FONT_CHAR_COUNT);
+  bool proportional = readFontByte(font) || readFontByte(font + 1) > 1;
+  uint8_t scale = proportional ? mag : 1;
+  run->chars = 0;
+  uint32_t setup = oled.m_bytes;
+  double t0 = seconds();
+  for (int p = 0; p < passes; p++) {
+    for (int c = first; c < first + count && c < 256; c++) {
+      put(oled, c, scale, run);
+    }
+    for (int i = 0; i < 4; i++) {
+      for (const char *s = line; *s; s++) {
+        put(oled, *s, scale, run);
+      }
+    }
+  }
+  run->seconds = seconds() - t0;
+  run->hash = oled.m_hash;
+  run->bytes = oled.m_bytes - setup;
+}
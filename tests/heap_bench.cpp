@@ -0,0 +1,238 @@
+/*
+ * Heap trace replay
+ *
+ * Replays a synthetic trace shaped like a long REPL session (many small
+ * objects, growing strings and arrays, a parser pass per line) against
+ * heap_allocf() and against the host malloc, checks that no block is
+ * overwritten by another and prints the time and fragmentation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Heap.h"
+
+// About the free RAM left by linker_arduino.gsi, bounded by the two
+// symbols like there
+#define RAM_SIZE "160 * 1024"
+
+asm(".bss\n"
+    ".balign 16\n"
+    ".globl mrb_heap_start\n"
+    "mrb_heap_start:\n"
+    ".zero " RAM_SIZE "\n"
+    ".globl mrb_heap_end\n"
+    "mrb_heap_end:\n"
+    ".text\n");
+
+enum { OP_ALLOC, OP_REALLOC, OP_FREE, OP_LINE_BEGIN, OP_LINE_END };
+
+struct op {
+  unsigned char type;
+  unsigned short slot;
+  unsigned int size;
+};
+
+#define SLOTS     512
+#define LINES     4000
+#define MAX_OPS   (LINES * 64)
+
+static struct op trace[MAX_OPS];
+static int trace_len;
+
+static unsigned long seed = 1;
+
+static unsigned long
+rnd(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+// object sizes of an mruby build for a 32 bit CPU
+static unsigned int
+object_size(void)
+{
+  static const unsigned int small[] = { 20, 24, 24, 24, 32, 40, 48, 64 };
+  unsigned long r = rnd() % 100;
+  if (r < 80) return small[rnd() % 8];
+  if (r < 95) return 64 + rnd() % 448;
+  return 512 + rnd() % 3584;
+}
+
+static void
+make_trace(void)
+{
+  bool live[SLOTS] = { false };
+  unsigned int size[SLOTS];
+
+  for (int line = 0; line < LINES; line++) {
+    trace[trace_len++] = (struct op){ OP_LINE_BEGIN, 0, 0 };
+    // parser pool page and token buffer, freed with the parser
+    int first = SLOTS - 2;
+    trace[trace_len++] = (struct op){ OP_ALLOC, (unsigned short)first, 16000 };
+    trace[trace_len++] = (struct op){ OP_ALLOC, (unsigned short)(first + 1), 1024 };
+    for (int i = 0; i < 2; i++) {
+      trace[trace_len++] = (struct op){ OP_FREE, (unsigned short)(first + i), 0 };
+    }
+    trace[trace_len++] = (struct op){ OP_LINE_END, 0, 0 };
+
+    // evaluating the line
+    int n = 20 + rnd() % 30;
+    for (int i = 0; i < n; i++) {
+      unsigned short s = rnd() % (SLOTS - 2);
+      if (!live[s]) {
+        size[s] = object_size();
+        trace[trace_len++] = (struct op){ OP_ALLOC, s, size[s] };
+        live[s] = true;
+      } else if (rnd() % 4 == 0 && size[s] < 4096) {
+        size[s] += size[s] / 2 + 8;
+        trace[trace_len++] = (struct op){ OP_REALLOC, s, size[s] };
+      } else {
+        trace[trace_len++] = (struct op){ OP_FREE, s, 0 };
+        live[s] = false;
+      }
+    }
+  }
+  for (unsigned short s = 0; s < SLOTS; s++) {
+    if (live[s]) {
+      trace[trace_len++] = (struct op){ OP_FREE, s, 0 };
+    }
+  }
+}
+
+static void *ptr[SLOTS];
+static unsigned int len[SLOTS];
+
+static void
+fill(unsigned short s)
+{
+  memset(ptr[s], s & 0xff, len[s] < 64 ? len[s] : 64);
+}
+
+static bool
+intact(unsigned short s)
+{
+  unsigned char *p = (unsigned char *)ptr[s];
+  for (unsigned int i = 0; i < len[s] && i < 64; i++) {
+    if (p[i] != (s & 0xff)) return false;
+  }
+  return true;
+}
+
+typedef void *(*allocf)(void *p, size_t size);
+
+static void *
+heap_f(void *p, size_t size)
+{
+  return heap_allocf(NULL, p, size, NULL);
+}
+
+static void *
+malloc_f(void *p, size_t size)
+{
+  if (size == 0) {
+    free(p);
+    return NULL;
+  }
+  return realloc(p, size);
+}
+
+// returns false if a block was overwritten
+static bool
+replay(allocf f, bool arena, bool check)
+{
+  memset(ptr, 0, sizeof(ptr));
+  for (int i = 0; i < trace_len; i++) {
+    struct op *o = &trace[i];
+    unsigned short s = o->slot;
+    switch (o->type) {
+    case OP_ALLOC:
+      ptr[s] = f(NULL, o->size);
+      len[s] = o->size;
+      if (ptr[s] && check) fill(s);
+      break;
+    case OP_REALLOC:
+      if (ptr[s]) {
+        if (check && !intact(s)) return false;
+        void *q = f(ptr[s], o->size);
+        if (q) {
+          ptr[s] = q;
+          if (check && !intact(s)) return false;
+          len[s] = o->size;
+          if (check) fill(s);
+        }
+      }
+      break;
+    case OP_FREE:
+      if (ptr[s]) {
+        if (check && !intact(s)) return false;
+        f(ptr[s], 0);
+        ptr[s] = NULL;
+      }
+      break;
+    case OP_LINE_BEGIN:
+      if (arena) heap_arena_begin();
+      break;
+    case OP_LINE_END:
+      if (arena) heap_arena_end();
+      break;
+    }
+  }
+  return true;
+}
+
+static double
+seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(void)
+{
+  struct heap_stat st;
+  int result = 0;
+
+  make_trace();
+  printf("trace: %d operations\n", trace_len);
+
+  setup_heap();
+  if (!replay(heap_f, true, true)) {
+    printf("heap: block overwritten\n");
+    return 1;
+  }
+  heap_stat(&st);
+  // the trace runs the heap close to full, a few large requests may
+  // find no block big enough
+  printf("heap: peak %u of %u, %lu allocations failed\n",
+         (unsigned)st.peak, (unsigned)st.total, st.failures);
+  printf("arena: peak %u spills %lu\n", (unsigned)st.arena_peak, st.arena_spills);
+  if (st.used != 0 || st.free_blocks != 1 || st.pool_pages != 0) {
+    printf("heap: not empty after freeing everything\n");
+    result = 1;
+  }
+  if (st.arena_spills) {
+    printf("arena: parser blocks spilled to the heap\n");
+    result = 1;
+  }
+
+  const int rounds = 20;
+  double t = seconds();
+  for (int i = 0; i < rounds; i++) {
+    setup_heap();
+    replay(heap_f, true, false);
+  }
+  double heap_ns = (seconds() - t) * 1e9 / ((double)rounds * trace_len);
+
+  t = seconds();
+  for (int i = 0; i < rounds; i++) {
+    replay(malloc_f, false, false);
+  }
+  double malloc_ns = (seconds() - t) * 1e9 / ((double)rounds * trace_len);
+
+  printf("time per operation: heap %.1f ns, malloc %.1f ns\n", heap_ns, malloc_ns);
+  return result;
+}
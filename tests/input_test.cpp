@@ -0,0 +1,137 @@
+/*
+ * XON/XOFF flow control of the input ring
+ *
+ * A sender pastes a script byte by byte into Input.cpp through the
+ * receive hook while the main loop reads at half the line rate, as when
+ * every byte is echoed. The sender stops only some bytes after XOFF, like
+ * a host with a transmit FIFO, and the transmit buffer is sometimes too
+ * full to take XOFF or XON at once. No byte may be lost with flow control
+ * on; without it the same paste overruns the ring.
+ */
+#include <stdio.h>
+#include <Arduino.h>
+#include "Input.h"
+
+#define SCRIPT_SIZE 4000
+#define LATENCY     16      // bytes still sent after XOFF
+#define CHANNEL     1
+
+bool serialRxHook(int serial_channel, unsigned char c);
+
+static int failures;
+
+static void
+check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static uint8_t
+script(int pos)
+{
+  return "  puts 'hello'\r\n"[pos % 16];
+}
+
+static struct {
+  bool stopped;           // last XOFF or XON received by the sender
+  int in_flight;          // bytes sent after XOFF before it took effect
+  int xoff;               // XOFF received
+  int xon;                // XON received
+  int refused;            // XOFF or XON the transmit buffer refused
+  int calls;
+  bool refuse_next;
+  bool alternate;         // never two XOFF or two XON in a row
+} sender;
+
+// The transmit buffer refuses every third request
+static bool
+flow(bool stop)
+{
+  if (++sender.calls % 3 == 0 || sender.refuse_next) {
+    sender.refuse_next = false;
+    sender.refused++;
+    return false;
+  }
+  if (stop == sender.stopped) sender.alternate = false;
+  sender.stopped = stop;
+  if (stop) {
+    sender.xoff++;
+    sender.in_flight = 0;
+  } else {
+    sender.xon++;
+  }
+  return true;
+}
+
+// Returns the number of bytes read back in order, -1 on a wrong byte
+static int
+paste(bool flow_control, int *max_fill)
+{
+  memset(&sender, 0, sizeof(sender));
+  sender.alternate = true;
+  input_flow_control(flow_control ? flow : NULL);
+  int sent = 0;
+  int got = 0;
+  *max_fill = 0;
+  for (long tick = 0; got < SCRIPT_SIZE && tick < 100L * SCRIPT_SIZE; tick++) {
+    if (sent < SCRIPT_SIZE && (!sender.stopped || sender.in_flight < LATENCY)) {
+      if (sender.stopped) sender.in_flight++;
+      serialRxHook(CHANNEL, script(sent++));
+    }
+    if (input_available() > *max_fill) *max_fill = input_available();
+    if (tick & 1) {
+      int c = input_read();
+      if (c >= 0) {
+        if (c != script(got)) return -1;
+        got++;
+      }
+    }
+    if (sent == SCRIPT_SIZE && input_available() == 0) break;
+  }
+  return got;
+}
+
+int
+main(void)
+{
+  setup_input(CHANNEL);
+  check(!serialRxHook(CHANNEL + 1, 'x'), "other channels are left alone");
+
+  int max_fill;
+  int got = paste(true, &max_fill);
+  check(got == SCRIPT_SIZE, "whole script read in order");
+  check(input_dropped() == 0, "no byte dropped with flow control");
+  check(sender.xoff > 0 && sender.alternate, "XOFF and XON in turn");
+  check(sender.refused > 0, "a refused XOFF or XON is sent again");
+  check(max_fill < INPUT_BUFFER_SIZE - 1, "ring never full");
+  printf("  flow control: %d XOFF, %d XON, %d refused, at most %d of %d keys waiting\n",
+         sender.xoff, sender.xon, sender.refused, max_fill, INPUT_BUFFER_SIZE - 1);
+
+  // A sender stopped when flow control is turned off is started, also
+  // when the transmit buffer refuses XON at first
+  for (int i = 0; i < INPUT_FLOW_HIGH; i++) serialRxHook(CHANNEL, 'x');
+  while (!sender.stopped && input_available()) {
+    input_getc();
+  }
+  check(sender.stopped, "XOFF once the ring is half full");
+  int refused = sender.refused;
+  sender.refuse_next = true;
+  input_flow_control(NULL);
+  check(!sender.stopped && sender.refused > refused, "XON when flow control is turned off");
+  while (input_read() >= 0) {
+  }
+
+  got = paste(false, &max_fill);
+  check(input_dropped() > 0, "without flow control the ring overruns");
+  printf("  no flow control: %lu of %d bytes dropped\n", input_dropped(),
+         SCRIPT_SIZE);
+
+  if (failures) {
+    printf("checks failed\n");
+    return 1;
+  }
+  return 0;
+}
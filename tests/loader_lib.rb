@@ -0,0 +1,7 @@
+# Copied to the SD image of loader_test as LIB.MRB
+def lib_square(x)
+  x * x
+end
+
+$lib_result = lib_square(12) + "abc".size
+$lib_loads = ($lib_loads || 0) + 1
@@ -0,0 +1,2 @@
+# Replaces LIB.MRB on the SD image of loader_test
+$lib_result = "changed"
@@ -0,0 +1,2 @@
+# Linked into the ROM table of loader_test as rom.mrb
+$rom_result = [1, 2, 3].map { |i| i * 2 }.inspect
@@ -0,0 +1,202 @@
+/*
+ * load and require of precompiled bytecode
+ *
+ * Runs scripts compiled by mrbc through Loader.cpp, one from the ROM
+ * table and the others from a FAT16 image on the SD card simulator, and
+ * checks the results they leave in global variables. The mruby heap is
+ * counted to see that loading an unchanged file again and a file that
+ * does not load leave no copy of the image behind.
+ */
+#include <stdio.h>
+#include <SD.h>
+#include <mruby.h>
+#include <mruby/class.h>
+#include <mruby/string.h>
+#include <mruby/variable.h>
+#include "Loader.h"
+#include "sd_sim.h"
+
+static int failures;
+static size_t live;             // bytes allocated by mruby
+
+static void
+check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+// The size is kept in front of each block, two words keep the alignment
+static void *
+counting_alloc(mrb_state *mrb, void *p, size_t size, void *ud)
+{
+  size_t *h = p ? (size_t *)p - 2 : NULL;
+  size_t old = h ? h[0] : 0;
+
+  if (size == 0) {
+    live -= old;
+    free(h);
+    return NULL;
+  }
+  h = (size_t *)realloc(h, size + 2 * sizeof(size_t));
+  if (h == NULL) return NULL;
+  live = live - old + size;
+  h[0] = size;
+  return h + 2;
+}
+
+static size_t
+live_after_gc(mrb_state *mrb)
+{
+  mrb_full_gc(mrb);
+  return live;
+}
+
+// Copy a file written by mrbc to the card, flip one byte if asked to
+static long
+copy_to_sd(const char *path, const char *name, long flip = -1)
+{
+  static uint8_t buf[4096];
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) return -1;
+  long size = fread(buf, 1, sizeof(buf), fp);
+  fclose(fp);
+  if (flip >= 0 && flip < size) buf[flip] ^= 0x10;
+
+  SD.remove(name);
+  File f = SD.open(name, FILE_WRITE);
+  if (!f) return -1;
+  bool ok = f.write(buf, size) == (size_t)size;
+  f.close();
+  return ok ? size : -1;
+}
+
+static const struct loader_info *
+find_info(const char *name)
+{
+  for (int i = 0; i < loader_count(); i++) {
+    if (strcmp(loader_get_info(i)->name, name) == 0) {
+      return loader_get_info(i);
+    }
+  }
+  return NULL;
+}
+
+static mrb_value
+gv(mrb_state *mrb, const char *name)
+{
+  return mrb_gv_get(mrb, mrb_intern_cstr(mrb, name));
+}
+
+static bool
+gv_is(mrb_state *mrb, const char *name, const char *s)
+{
+  mrb_value v = gv(mrb, name);
+  return mrb_string_p(v) && strcmp(mrb_str_to_cstr(mrb, v), s) == 0;
+}
+
+static bool
+gv_is(mrb_state *mrb, const char *name, mrb_int i)
+{
+  mrb_value v = gv(mrb, name);
+  return mrb_fixnum_p(v) && mrb_fixnum(v) == i;
+}
+
+static mrb_value
+require(mrb_state *mrb, const char *feature)
+{
+  return mrb_funcall(mrb, mrb_top_self(mrb), "require", 1, mrb_str_new_cstr(mrb, feature));
+}
+
+static void
+print_info(const char *name)
+{
+  const struct loader_info *info = find_info(name);
+  if (info) {
+    printf("  %-8s %s %4u bytes, RAM %5u, in place %4u\n", info->name,
+           info->rom ? "ROM" : "SD ", (unsigned)info->size,
+           (unsigned)info->ram, (unsigned)info->in_place);
+  }
+}
+
+int
+main(void)
+{
+  if (!sd_sim_open("loader.img", 32768) || !sd_sim_format(false)) {
+    printf("FAIL: create image\n");
+    return 1;
+  }
+  check(loader_sd_begin(), "SD.begin");
+  long lib_size = copy_to_sd("loader_lib.mrb", "lib.mrb");
+  check(lib_size > 0, "copy lib.mrb");
+  // a byte after the header, the CRC no longer matches
+  long bad_size = copy_to_sd("loader_lib.mrb", "bad.mrb", 40);
+  check(bad_size > 0, "copy bad.mrb");
+
+  mrb_state *mrb = mrb_open_allocf(counting_alloc, NULL);
+  if (mrb == NULL) {
+    printf("FAIL: mrb_open\n");
+    return 1;
+  }
+  setup_loader(mrb);
+
+  check(loader_run(mrb, "rom.mrb") && !mrb->exc, "load rom.mrb");
+  check(gv_is(mrb, "$rom_result", "[2, 4, 6]"), "result of rom.mrb");
+  const struct loader_info *info = find_info("rom.mrb");
+  check(info && info->rom && info->in_place > 0, "rom.mrb runs in place");
+
+  check(mrb_true_p(require(mrb, "lib")) && !mrb->exc, "require lib");
+  check(gv_is(mrb, "$lib_result", 147), "result of lib.mrb");
+  check(mrb_false_p(require(mrb, "lib.mrb")) && !mrb->exc, "require lib.mrb again");
+  check(gv_is(mrb, "$lib_loads", 1), "lib.mrb runs once");
+  info = find_info("lib.mrb");
+  check(info && !info->rom && info->ram >= (size_t)lib_size, "lib.mrb in RAM");
+  print_info("rom.mrb");
+  print_info("lib.mrb");
+
+  // the same file again runs from the copy read the first time
+  int count = loader_count();
+  size_t before = live_after_gc(mrb);
+  for (int i = 0; i < 10; i++) {
+    check(loader_run(mrb, "lib.mrb") && !mrb->exc, "load lib.mrb");
+  }
+  size_t after = live_after_gc(mrb);
+  check(gv_is(mrb, "$lib_loads", 11), "lib.mrb runs each time");
+  check(loader_count() == count, "one entry per file");
+  check(after < before + lib_size, "unchanged lib.mrb is not copied again");
+  printf("  load lib.mrb 10 times: heap %u -> %u bytes\n", (unsigned)before, (unsigned)after);
+
+  // an image that does not load is freed
+  before = live_after_gc(mrb);
+  for (int i = 0; i < 10; i++) {
+    check(loader_run(mrb, "bad.mrb"), "bad.mrb is found");
+    check(mrb->exc && mrb_obj_is_kind_of(mrb, mrb_obj_value(mrb->exc), E_SCRIPT_ERROR),
+          "bad.mrb raises ScriptError");
+    mrb->exc = NULL;
+  }
+  after = live_after_gc(mrb);
+  check(after < before + bad_size, "bad.mrb is freed");
+  check(find_info("bad.mrb") == NULL, "bad.mrb is not listed");
+  printf("  load bad.mrb 10 times: heap %u -> %u bytes\n", (unsigned)before, (unsigned)after);
+
+  // a changed file is read again
+  check(copy_to_sd("loader_lib2.mrb", "lib.mrb") > 0, "replace lib.mrb");
+  check(loader_run(mrb, "lib.mrb") && !mrb->exc, "load changed lib.mrb");
+  check(gv_is(mrb, "$lib_result", "changed"), "result of changed lib.mrb");
+
+  check(!loader_run(mrb, "none.mrb"), "missing file");
+  mrb_funcall(mrb, mrb_top_self(mrb), "load", 1, mrb_str_new_lit(mrb, "none.mrb"));
+  check(mrb->exc && mrb_obj_is_kind_of(mrb, mrb_obj_value(mrb->exc), E_SCRIPT_ERROR),
+        "load of a missing file raises ScriptError");
+  mrb->exc = NULL;
+
+  mrb_close(mrb);
+  sd_sim_close();
+  if (failures) {
+    printf("checks failed\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * Scanner of continued REPL lines
+ *
+ * Checks BlockScan.cpp on a table of one-line cases, then feeds long
+ * class bodies one line at a time as the REPL does and counts the lines
+ * that would still be handed to the parser, against one parse per line
+ * without the scanner.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "BlockScan.h"
+
+static int failures;
+
+static void
+check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static double
+seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Whether a block of just this line is surely still open
+static const struct {
+  const char *line;
+  bool open;
+} cases[] = {
+  { "class Foo", true },
+  { "module Bar", true },
+  { "def foo(a, b)", true },
+  { "def foo; end", false },
+  { "def end?", true },
+  { "begin", true },
+  { "case x", true },
+  { "if x > 1", true },
+  { "unless x", true },
+  { "x = 1 if y", false },
+  { "return unless x", false },
+  { "while x do", true },
+  { "until done", true },
+  { "for i in 1..3 do", true },
+  { "x += 1 while x < 3", false },
+  { "[1, 2].each do |i|", true },
+  { "foo.each { |x|", true },
+  { "a = [1,", true },
+  { "h = {if: 1}", false },
+  { "h = {if: 1,", true },
+  { "foo(:end)", false },
+  { "x.class", false },
+  { "Foo::Bar.new", false },
+  { "puts 'end'", false },
+  { "s = \"class", true },
+  { "s = 'it''s'", false },
+  { "x = 1 # class", false },
+  { "y = x ? 1 : 2", false },
+  { "z = y / 2", false },
+  { "1.upto(3) { |i| p i }", false },
+  { "end", false },
+  // unsure, the parser decides
+  { "s = \"#{x}", false },
+  { "x = /class/", false },
+  { "x = %w(a b", false },
+  { "c = ?a", false },
+  { "a = <<EOS", false },
+  { "=begin", false },
+  { "__END__", false },
+};
+
+// A class body as typed at the prompt, one parse is enough for all of it
+static const char *body[] = {
+  "class Blinker",
+  "  attr_reader :pin, :count",
+  "",
+  "  def initialize(pin, period = 500)",
+  "    @pin = pin",
+  "    @period = period",
+  "    @count = 0",
+  "    @state = false",
+  "  end",
+  "",
+  "  # toggle the LED and count",
+  "  def toggle",
+  "    @state = !@state",
+  "    digitalWrite(@pin, @state ? 1 : 0)",
+  "    @count += 1",
+  "  end",
+  "",
+  "  def run(times)",
+  "    times.times do |i|",
+  "      toggle",
+  "      delay(@period / 2)",
+  "      puts 'blink' if i % 10 == 0",
+  "    end",
+  "  end",
+  "",
+  "  def stats",
+  "    h = { pin: @pin, count: @count,",
+  "          period: @period }",
+  "    h.each { |k, v| puts \"k=\", k, 'v=', v }",
+  "  end",
+  "",
+  "  def slow?",
+  "    case @period",
+  "    when 0..100 then false",
+  "    else",
+  "      true",
+  "    end",
+  "  end",
+  "",
+  "  def reset",
+  "    while @count > 0",
+  "      @count -= 1",
+  "    end",
+  "    self",
+  "  end",
+  "end",
+};
+
+#define BODY_LINES (sizeof(body) / sizeof(body[0]))
+#define PASSES     100000
+// Index of the puts line in run()
+#define UNSURE_LINE 21
+
+// Returns the number of lines that would go to the parser, the REPL
+// parses when the scanner is not sure the block is open
+static int
+feed(const char **lines, int n)
+{
+  int parses = 0;
+  block_scan_reset();
+  for (int i = 0; i < n; i++) {
+    block_scan_line(lines[i]);
+    if (!block_surely_open()) parses++;
+  }
+  return parses;
+}
+
+int
+main(void)
+{
+  char what[80];
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    block_scan_reset();
+    block_scan_line(cases[i].line);
+    snprintf(what, sizeof(what), "%s: %s", cases[i].line,
+             cases[i].open ? "open" : "not surely open");
+    check(block_surely_open() == cases[i].open, what);
+  }
+
+  // Only the closing "end" of the class is parsed
+  int parses = feed(body, BODY_LINES);
+  check(BODY_LINES >= 40, "class body of 40 lines or more");
+  check(parses == 1, "one parse for the class body");
+  printf("  class body of %d lines: %d parse(s), %d without the scanner\n",
+         (int)BODY_LINES, parses, (int)BODY_LINES);
+
+  // An interpolated string makes the scanner unsure, from that line on
+  // each line is parsed as before
+  static const char *unsure[BODY_LINES];
+  memcpy(unsure, body, sizeof(body));
+  unsure[UNSURE_LINE] = "      puts \"blink #{i}\" if i % 10 == 0";
+  parses = feed(unsure, BODY_LINES);
+  check(parses == (int)(BODY_LINES - UNSURE_LINE), "parse each line once unsure");
+  printf("  with an interpolated string on line %d: %d parse(s)\n",
+         UNSURE_LINE + 1, parses);
+
+  double t0 = seconds();
+  for (int p = 0; p < PASSES; p++) {
+    feed(body, BODY_LINES);
+  }
+  double t = seconds() - t0;
+  printf("  scan: %.1f ns per line\n", t * 1e9 / PASSES / BODY_LINES);
+
+  if (failures) {
+    printf("checks failed\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * SdFile::seekSet benchmark
+ *
+ * Builds a 4 MB file in one piece, in 6 pieces and in 64 pieces on
+ * FAT16 and FAT32 images of the card simulator and times random seeks
+ * on a file just opened (the walk the FAT had to do for every backward
+ * seek before the extent map) and on an open file whose map is built.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <SD.h>
+#include "sd_sim.h"
+
+#define FILE_SIZE (4UL * 1024 * 1024)
+#define SEEKS     2000
+
+static int failures;
+
+static uint8_t
+pattern(uint32_t pos)
+{
+  return (pos * 7 + (pos >> 9)) & 0xff;
+}
+
+static double
+seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Write DATA.BIN in the given number of pieces, with one cluster of
+// GAP.BIN between them
+static bool
+make_file(SdFile &root, int pieces, uint32_t cluster_size)
+{
+  static uint8_t buf[4096];
+  SdFile data, gap;
+  if (!data.open(&root, "DATA.BIN", O_RDWR | O_CREAT | O_TRUNC) ||
+      !gap.open(&root, "GAP.BIN", O_RDWR | O_CREAT | O_TRUNC)) return false;
+  uint32_t piece = FILE_SIZE / pieces;
+  for (uint32_t pos = 0; pos < FILE_SIZE; pos += sizeof(buf)) {
+    if (pos && pos % piece == 0) {
+      memset(buf, 0, sizeof(buf));
+      if (gap.write(buf, cluster_size) != cluster_size) return false;
+    }
+    for (uint32_t i = 0; i < sizeof(buf); i++) buf[i] = pattern(pos + i);
+    if (data.write(buf, sizeof(buf)) != sizeof(buf)) return false;
+  }
+  return data.close() && gap.close();
+}
+
+static uint32_t positions[SEEKS];
+
+static void
+bench(SdFile &root, int pieces, uint32_t cluster_size)
+{
+  SdFile f;
+  uint32_t clusters_walked = 0;
+  uint32_t prev = 0;
+
+  for (int i = 0; i < SEEKS; i++) {
+    positions[i] = (uint32_t)(((uint64_t)i * 2654435761u) % FILE_SIZE);
+    // what the walk without a map took: from the current cluster going
+    // forward, from the first cluster going back
+    uint32_t n = positions[i] / cluster_size;
+    uint32_t c = prev / cluster_size;
+    clusters_walked += n >= c && prev ? n - c : n;
+    prev = positions[i];
+  }
+
+  // every seek on a file just opened walks the chain
+  sd_sim_reset_stat();
+  double t = seconds();
+  for (int i = 0; i < SEEKS; i++) {
+    if (!f.open(&root, "DATA.BIN", O_READ) || !f.seekSet(positions[i])) {
+      printf("FAIL: seek %u\n", positions[i]);
+      failures++;
+      return;
+    }
+    f.close();
+  }
+  double cold = (seconds() - t) * 1e6 / SEEKS;
+  unsigned long cold_fat = sd_sim_stat.cmd[CMD17];
+
+  // one open file, the map is built by the first seeks
+  if (!f.open(&root, "DATA.BIN", O_READ)) {
+    failures++;
+    return;
+  }
+  sd_sim_reset_stat();
+  t = seconds();
+  for (int i = 0; i < SEEKS; i++) {
+    f.seekSet(positions[i]);
+  }
+  double warm = (seconds() - t) * 1e6 / SEEKS;
+  unsigned long warm_fat = sd_sim_stat.cmd[CMD17];
+
+  // the data found through the map is right
+  for (int i = 0; i < SEEKS; i += 7) {
+    uint8_t b[4];
+    uint32_t pos = positions[i] < FILE_SIZE - 4 ? positions[i] : FILE_SIZE - 4;
+    if (!f.seekSet(pos) || f.read(b, 4) != 4 ||
+        b[0] != pattern(pos) || b[3] != pattern(pos + 3)) {
+      printf("FAIL: data at %u\n", pos);
+      failures++;
+      break;
+    }
+  }
+  f.close();
+
+  printf("  %2d pieces: walk without map %6.0f clusters/seek, "
+         "just opened %8.2f us %5lu FAT reads, open %6.2f us %4lu FAT reads\n",
+         pieces, (double)clusters_walked / SEEKS, cold, cold_fat, warm, warm_fat);
+}
+
+static void
+run(bool fat32, uint32_t blocks)
+{
+  static const int pieces[] = { 1, 6, 64 };
+  Sd2Card card;
+  SdVolume volume;
+
+  printf("FAT%d\n", fat32 ? 32 : 16);
+  for (int i = 0; i < 3; i++) {
+    SdFile root;
+    if (!sd_sim_open(fat32 ? "seek32.img" : "seek16.img", blocks) ||
+        !sd_sim_format(fat32) ||
+        !card.init(SPI_FULL_SPEED, SS) || !volume.init(&card) ||
+        !root.openRoot(&volume)) {
+      printf("FAIL: mount\n");
+      failures++;
+      return;
+    }
+    uint32_t cluster_size = 512UL * volume.blocksPerCluster();
+    if (!make_file(root, pieces[i], cluster_size)) {
+      printf("FAIL: write\n");
+      failures++;
+      return;
+    }
+    bench(root, pieces[i], cluster_size);
+    root.close();
+    sd_sim_close();
+  }
+}
+
+int
+main(void)
+{
+  run(false, 32768);
+  run(true, 69632);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,365 @@
+/* SD card simulator, see sd_sim.h */
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <SPI.h>
+#include "SdInfo.h"
+#include "FatStructs.h"
+#include "sd_sim.h"
+
+struct sd_sim_stat sd_sim_stat;
+
+SPIClass SPI;
+uint8_t (*spi_host_device)(uint8_t data);
+uint32_t spi_host_clock = 4000000;
+
+enum {
+  SIM_IDLE,
+  SIM_COMMAND,      // receiving the six bytes of a command
+  SIM_WAIT_TOKEN,   // CMD24 done, waiting for the start token
+  SIM_RECEIVE,      // receiving a data block and its CRC
+  SIM_MULTI_WRITE,  // CMD25 done, waiting for a token
+  SIM_MULTI_READ,   // CMD18 done, sending blocks until CMD12
+};
+
+static int image = -1;
+static uint32_t image_blocks;
+
+static uint8_t state;
+static uint8_t receive_next;  // state after a data block
+static uint8_t command[6];
+static uint8_t command_len;
+static bool app_command;
+static bool ready;
+static uint32_t block;
+static uint32_t erase_first, erase_last;
+static uint8_t data[514];
+static uint16_t data_len;
+
+static uint8_t out[1024];
+static uint16_t out_head, out_tail;
+
+static void
+put(uint8_t b)
+{
+  out[out_tail++] = b;
+}
+
+static void
+put_block(uint32_t n)
+{
+  uint8_t buf[512];
+  if (!sd_sim_read(n, buf)) {
+    put(0x08);  // data error token, out of range
+    return;
+  }
+  put(0xff);  // access time
+  put(DATA_START_BLOCK);
+  for (int i = 0; i < 512; i++) put(buf[i]);
+  put(0xff);
+  put(0xff);
+  sd_sim_stat.blocks_read++;
+}
+
+static void
+put_register(const uint8_t *reg)
+{
+  put(0xff);
+  put(DATA_START_BLOCK);
+  for (int i = 0; i < 16; i++) put(reg[i]);
+  put(0xff);
+  put(0xff);
+}
+
+static void
+execute(void)
+{
+  uint8_t cmd = command[0] & 0x3f;
+  uint32_t arg = (uint32_t)command[1] << 24 | (uint32_t)command[2] << 16 |
+                 (uint32_t)command[3] << 8 | command[4];
+  uint8_t r1 = ready ? R1_READY_STATE : R1_IDLE_STATE;
+
+  sd_sim_stat.cmd[cmd]++;
+  state = SIM_IDLE;
+  out_head = out_tail = 0;
+
+  if (cmd == CMD12) {
+    put(0xff);  // stuff byte
+  }
+  put(0xff);    // command response time
+
+  if (app_command) {
+    app_command = false;
+    if (cmd == ACMD41) {
+      ready = true;
+      put(R1_READY_STATE);
+    } else {
+      put(r1);  // ACMD23
+    }
+    return;
+  }
+
+  switch (cmd) {
+  case CMD0:
+    ready = false;
+    put(R1_IDLE_STATE);
+    break;
+  case CMD8:
+    put(r1);
+    put(0x00); put(0x00); put(0x01); put(arg & 0xff);
+    break;
+  case CMD9: {
+    uint8_t csd[16] = { 0 };
+    uint32_t c_size = image_blocks / 1024 - 1;
+    csd[0] = 0x40;      // CSD version 2
+    csd[5] = 0x59;      // read_bl_len 9
+    csd[7] = (c_size >> 16) & 0x3f;
+    csd[8] = c_size >> 8;
+    csd[9] = c_size;
+    csd[10] = 0x40;     // erase_blk_en
+    put(r1);
+    put_register(csd);
+    break;
+  }
+  case CMD10: {
+    uint8_t cid[16] = { 0 };
+    put(r1);
+    put_register(cid);
+    break;
+  }
+  case CMD12:
+    put(R1_READY_STATE);
+    break;
+  case CMD13:
+    put(R1_READY_STATE);
+    put(0x00);
+    break;
+  case CMD17:
+    put(R1_READY_STATE);
+    put_block(arg);
+    break;
+  case CMD18:
+    put(R1_READY_STATE);
+    block = arg;
+    state = SIM_MULTI_READ;
+    break;
+  case CMD24:
+    put(R1_READY_STATE);
+    block = arg;
+    state = SIM_WAIT_TOKEN;
+    break;
+  case CMD25:
+    put(R1_READY_STATE);
+    block = arg;
+    state = SIM_MULTI_WRITE;
+    break;
+  case CMD32:
+    erase_first = arg;
+    put(R1_READY_STATE);
+    break;
+  case CMD33:
+    erase_last = arg;
+    put(R1_READY_STATE);
+    break;
+  case CMD38: {
+    uint8_t zero[512] = { 0 };
+    for (uint32_t n = erase_first; n <= erase_last; n++) sd_sim_write(n, zero);
+    put(R1_READY_STATE);
+    put(0x00);  // busy
+    break;
+  }
+  case CMD55:
+    app_command = true;
+    put(r1);
+    break;
+  case CMD58:
+    put(r1);
+    put(0xc0);  // powered up, SDHC
+    put(0xff); put(0x80); put(0x00);
+    break;
+  default:
+    put(r1 | R1_ILLEGAL_COMMAND);
+    break;
+  }
+}
+
+static uint8_t
+transfer(uint8_t in)
+{
+  sd_sim_stat.bus_bytes++;
+
+  if (state == SIM_RECEIVE) {
+    data[data_len++] = in;
+    if (data_len == sizeof(data)) {
+      bool ok = sd_sim_write(block, data);
+      if (ok) sd_sim_stat.blocks_written++;
+      put(ok ? DATA_RES_ACCEPTED : 0x0d);  // accepted or write error
+      put(0x00);                           // busy while programming
+      block++;
+      state = receive_next;
+    }
+    return 0xff;
+  }
+  if (state == SIM_COMMAND) {
+    command[command_len++] = in;
+    if (command_len == sizeof(command)) execute();
+    return 0xff;
+  }
+  if ((in & 0xc0) == 0x40) {
+    // a command ends a multiple block read
+    state = SIM_COMMAND;
+    command[0] = in;
+    command_len = 1;
+    out_head = out_tail = 0;
+    return 0xff;
+  }
+  if ((state == SIM_WAIT_TOKEN && in == DATA_START_BLOCK) ||
+      (state == SIM_MULTI_WRITE && in == WRITE_MULTIPLE_TOKEN)) {
+    receive_next = state == SIM_WAIT_TOKEN ? SIM_IDLE : SIM_MULTI_WRITE;
+    state = SIM_RECEIVE;
+    data_len = 0;
+    return 0xff;
+  }
+  if (state == SIM_MULTI_WRITE && in == STOP_TRAN_TOKEN) {
+    state = SIM_IDLE;
+    out_head = out_tail = 0;
+    put(0xff);
+    put(0x00);  // busy
+    return 0xff;
+  }
+
+  if (out_head == out_tail) {
+    out_head = out_tail = 0;
+    if (state != SIM_MULTI_READ) return 0xff;
+    put_block(block++);
+  }
+  return out[out_head++];
+}
+
+bool
+sd_sim_open(const char *path, uint32_t blocks)
+{
+  image = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (image < 0) return false;
+  if (ftruncate(image, (off_t)blocks * 512) < 0) {
+    sd_sim_close();
+    return false;
+  }
+  image_blocks = blocks;
+  state = SIM_IDLE;
+  app_command = false;
+  ready = false;
+  out_head = out_tail = 0;
+  spi_host_device = transfer;
+  sd_sim_reset_stat();
+  return true;
+}
+
+void
+sd_sim_close(void)
+{
+  if (image >= 0) close(image);
+  image = -1;
+}
+
+void
+sd_sim_reset_stat(void)
+{
+  memset(&sd_sim_stat, 0, sizeof(sd_sim_stat));
+}
+
+bool
+sd_sim_read(uint32_t n, uint8_t *buf)
+{
+  return n < image_blocks && pread(image, buf, 512, (off_t)n * 512) == 512;
+}
+
+bool
+sd_sim_write(uint32_t n, const uint8_t *buf)
+{
+  return n < image_blocks && pwrite(image, buf, 512, (off_t)n * 512) == 512;
+}
+
+double
+sd_sim_bus_time(void)
+{
+  return sd_sim_stat.bus_bytes * 8.0 / spi_host_clock;
+}
+
+// Set FAT entry n of both FATs in the image
+static void
+fat_set(uint32_t fat_start, uint32_t fat_blocks, bool fat32, uint32_t n, uint32_t v)
+{
+  uint8_t buf[512];
+  uint32_t size = fat32 ? 4 : 2;
+  uint32_t offset = n * size;
+  for (int i = 0; i < 2; i++) {
+    uint32_t b = fat_start + i * fat_blocks + offset / 512;
+    sd_sim_read(b, buf);
+    memcpy(buf + offset % 512, &v, size);
+    sd_sim_write(b, buf);
+  }
+}
+
+bool
+sd_sim_format(bool fat32)
+{
+  uint8_t buf[512];
+  uint8_t spc = fat32 ? 1 : 4;
+  uint16_t reserved = fat32 ? 32 : 1;
+  uint16_t root_entries = fat32 ? 0 : 512;
+  uint32_t root_blocks = root_entries * 32 / 512;
+  uint32_t fat_blocks = 1;
+
+  // grow the FATs until they cover every cluster left after them
+  for (;;) {
+    uint32_t clusters = (image_blocks - reserved - 2 * fat_blocks - root_blocks) / spc;
+    uint32_t need = ((clusters + 2) * (fat32 ? 4 : 2) + 511) / 512;
+    if (need <= fat_blocks) break;
+    fat_blocks = need;
+  }
+  uint32_t clusters = (image_blocks - reserved - 2 * fat_blocks - root_blocks) / spc;
+  if (fat32 ? clusters < 65525 : clusters < 4085 || clusters >= 65525) return false;
+
+  memset(buf, 0, sizeof(buf));
+  for (uint32_t n = 0; n < reserved + 2 * fat_blocks + root_blocks + spc; n++) {
+    if (!sd_sim_write(n, buf)) return false;
+  }
+
+  fbs_t *fbs = (fbs_t *)buf;
+  bpb_t *bpb = &fbs->bpb;
+  fbs->jmpToBootCode[0] = 0xeb;
+  fbs->jmpToBootCode[1] = 0x58;
+  fbs->jmpToBootCode[2] = 0x90;
+  memcpy(fbs->oemName, "SDSIM   ", 8);
+  bpb->bytesPerSector = 512;
+  bpb->sectorsPerCluster = spc;
+  bpb->reservedSectorCount = reserved;
+  bpb->fatCount = 2;
+  bpb->rootDirEntryCount = root_entries;
+  if (image_blocks < 65536 && !fat32) {
+    bpb->totalSectors16 = image_blocks;
+  } else {
+    bpb->totalSectors32 = image_blocks;
+  }
+  bpb->mediaType = 0xf8;
+  if (fat32) {
+    bpb->sectorsPerFat32 = fat_blocks;
+    bpb->fat32RootCluster = 2;
+  } else {
+    bpb->sectorsPerFat16 = fat_blocks;
+  }
+  fbs->bootSectorSig0 = BOOTSIG0;
+  fbs->bootSectorSig1 = BOOTSIG1;
+  if (!sd_sim_write(0, buf)) return false;
+
+  if (fat32) {
+    fat_set(reserved, fat_blocks, true, 0, 0x0ffffff8);
+    fat_set(reserved, fat_blocks, true, 1, 0x0fffffff);
+    fat_set(reserved, fat_blocks, true, 2, 0x0fffffff);  // root directory
+  } else {
+    fat_set(reserved, fat_blocks, false, 0, 0xfff8);
+    fat_set(reserved, fat_blocks, false, 1, 0xffff);
+  }
+  return true;
+}
@@ -0,0 +1,37 @@
+/*
+ * SD card simulator
+ *
+ * An SDHC card in SPI mode behind the host SPI stub, backed by an image
+ * file. The real Sd2Card.cpp talks to it byte by byte, the simulator
+ * counts the commands and the bytes on the bus.
+ */
+#ifndef SD_SIM_H
+#define SD_SIM_H
+
+#include <stdint.h>
+
+struct sd_sim_stat {
+  unsigned long cmd[64];        // commands received, by number
+  unsigned long blocks_read;    // data blocks sent to the host
+  unsigned long blocks_written; // data blocks accepted
+  unsigned long bus_bytes;      // bytes clocked over SPI
+};
+
+extern struct sd_sim_stat sd_sim_stat;
+
+// Create an image of blocks * 512 bytes and attach it to the SPI stub
+bool sd_sim_open(const char *path, uint32_t blocks);
+void sd_sim_close(void);
+void sd_sim_reset_stat(void);
+
+// Direct access to the image, not counted
+bool sd_sim_read(uint32_t block, uint8_t *buf);
+bool sd_sim_write(uint32_t block, const uint8_t *buf);
+
+// Write an empty FAT16 or FAT32 file system over the whole image
+bool sd_sim_format(bool fat32);
+
+// Seconds the bus needs for the bytes counted, at the SPI clock in use
+double sd_sim_bus_time(void);
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * SD multiple block transfers
+ *
+ * Writes and reads files through the SD library on FAT16 and FAT32
+ * images of the card simulator, checks the data and prints the commands
+ * and bus bytes each access pattern takes. The rate is for the bus time
+ * at 25 MHz only, a real card adds its access or programming time to
+ * every command. A file grown in small pieces checks that the block
+ * cache keeps its FAT and directory blocks and that both FATs reach the
+ * card only on sync(). SD_MAX_OPEN_FILES files written and read in turn
+ * check the table of open files.
+ */
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <SD.h>
+#include "sd_sim.h"
+
+#define FILE_SIZE (256UL * 1024)
+#define CHUNK     8192
+#define CHAIN_SIZE (8UL * 1024)
+#define MULTI_SIZE (16UL * 1024)
+
+static int failures;
+
+static void
+check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static uint8_t
+pattern(uint32_t pos)
+{
+  return (pos * 7 + (pos >> 9)) & 0xff;
+}
+
+static void
+report(const char *what, uint32_t bytes)
+{
+  double t = sd_sim_bus_time();
+  printf("  %-22s CMD17 %4lu CMD18 %3lu CMD24 %4lu CMD25 %3lu blocks %4lu/%4lu bus %7lu bytes %6.0f KB/s\n",
+         what, sd_sim_stat.cmd[CMD17], sd_sim_stat.cmd[CMD18],
+         sd_sim_stat.cmd[CMD24], sd_sim_stat.cmd[CMD25],
+         sd_sim_stat.blocks_read, sd_sim_stat.blocks_written,
+         sd_sim_stat.bus_bytes, t > 0 ? bytes / t / 1024 : 0);
+  sd_sim_reset_stat();
+}
+
+// Write name in chunks of size n, returns false on a short write
+static bool
+write_file(const char *name, uint32_t n)
+{
+  static uint8_t buf[CHUNK];
+  File f = SD.open(name, FILE_WRITE);
+  if (!f) return false;
+  for (uint32_t pos = 0; pos < FILE_SIZE; pos += n) {
+    uint32_t len = FILE_SIZE - pos < n ? FILE_SIZE - pos : n;
+    for (uint32_t i = 0; i < len; i++) buf[i] = pattern(pos + i);
+    if (f.write(buf, len) != len) return false;
+  }
+  f.close();
+  return true;
+}
+
+// Read name back in chunks of size n and compare it with the pattern
+static bool
+read_file(const char *name, uint32_t n)
+{
+  static uint8_t buf[CHUNK];
+  File f = SD.open(name);
+  if (!f || f.size() != FILE_SIZE) return false;
+  for (uint32_t pos = 0; pos < FILE_SIZE; pos += n) {
+    uint32_t len = FILE_SIZE - pos < n ? FILE_SIZE - pos : n;
+    if (f.read(buf, len) != (int)len) return false;
+    for (uint32_t i = 0; i < len; i++) {
+      if (buf[i] != pattern(pos + i)) return false;
+    }
+  }
+  bool end = f.read() == -1;
+  f.close();
+  return end;
+}
+
+// Reads at odd places, some of them across clusters
+static bool
+read_random(const char *name)
+{
+  uint8_t buf[3000];
+  File f = SD.open(name);
+  if (!f) return false;
+  uint32_t pos = 12345;
+  for (int i = 0; i < 50; i++) {
+    pos = (pos * 1103515245 + 12345) % (FILE_SIZE - sizeof(buf));
+    if (!f.seek(pos) || f.read(buf, sizeof(buf)) != sizeof(buf)) return false;
+    for (uint32_t j = 0; j < sizeof(buf); j++) {
+      if (buf[j] != pattern(pos + j)) return false;
+    }
+  }
+  f.close();
+  return true;
+}
+
+// The FATs on the image, from the boot sector sd_sim_format() wrote
+static void
+fat_layout(uint32_t *start, uint32_t *blocks)
+{
+  static uint8_t buf[512];
+  sd_sim_read(0, buf);
+  bpb_t *bpb = &((fbs_t *)buf)->bpb;
+  *start = bpb->reservedSectorCount;
+  *blocks = bpb->sectorsPerFat16 ? bpb->sectorsPerFat16 : bpb->sectorsPerFat32;
+}
+
+// Copy of one FAT as it is on the image
+static uint8_t *
+fat_image(uint32_t start, uint32_t blocks)
+{
+  uint8_t *fat = (uint8_t *)malloc(blocks * 512);
+  for (uint32_t i = 0; i < blocks; i++) sd_sim_read(start + i, fat + i * 512);
+  return fat;
+}
+
+// Grow a file in 100 byte chunks with its directory entry and a data
+// block open, the FAT chain is followed and extended on the way. The
+// FAT and directory blocks stay cached and both FATs on the card are
+// only written by sync().
+static void
+test_cache(void)
+{
+  uint32_t fat_start, fat_blocks;
+  fat_layout(&fat_start, &fat_blocks);
+  uint8_t *fat1 = fat_image(fat_start, fat_blocks);
+  uint8_t *fat2 = fat_image(fat_start + fat_blocks, fat_blocks);
+
+  // The first cluster may take a search through the FAT, the counts
+  // start after it
+  File f = SD.open("CHAIN.BIN", FILE_WRITE);
+  check(f, "open CHAIN.BIN");
+  uint8_t buf[100];
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  for (uint32_t pos = 0; pos < CHAIN_SIZE; pos += sizeof(buf)) {
+    uint32_t len = CHAIN_SIZE - pos < sizeof(buf) ? CHAIN_SIZE - pos : sizeof(buf);
+    for (uint32_t i = 0; i < len; i++) buf[i] = pattern(pos + i);
+    f.write(buf, len);
+    if (pos == 0) {
+      hits = SdVolume::cacheHits();
+      misses = SdVolume::cacheMisses();
+      sd_sim_reset_stat();
+    }
+  }
+  hits = SdVolume::cacheHits() - hits;
+  misses = SdVolume::cacheMisses() - misses;
+  // at most the two FAT blocks the chain may span are read
+  check(misses <= 2 && sd_sim_stat.cmd[CMD17] <= 2, "FAT blocks read once");
+  check(hits > CHAIN_SIZE / 512, "FAT and data blocks found in the cache");
+  uint8_t *fat = fat_image(fat_start, fat_blocks);
+  check(memcmp(fat, fat1, fat_blocks * 512) == 0, "FAT not written before sync");
+  free(fat);
+  fat = fat_image(fat_start + fat_blocks, fat_blocks);
+  check(memcmp(fat, fat2, fat_blocks * 512) == 0, "mirror FAT not written before sync");
+  free(fat);
+  printf("  cache while writing: %lu hits, %lu misses\n",
+         (unsigned long)hits, (unsigned long)misses);
+  report("write 100 bytes, open", CHAIN_SIZE);
+
+  misses = SdVolume::cacheMisses();
+  f.flush();
+  check(SdVolume::cacheMisses() == misses, "directory entry still cached at sync");
+  free(fat1);
+  free(fat2);
+  fat1 = fat_image(fat_start, fat_blocks);
+  fat2 = fat_image(fat_start + fat_blocks, fat_blocks);
+  check(memcmp(fat1, fat2, fat_blocks * 512) == 0, "mirror FAT written by sync");
+  free(fat1);
+  free(fat2);
+  report("sync", 0);
+  f.close();
+
+  f = SD.open("CHAIN.BIN");
+  bool same = f && f.size() == CHAIN_SIZE;
+  for (uint32_t pos = 0; same && pos < CHAIN_SIZE; pos++) {
+    same = f.read() == pattern(pos);
+  }
+  f.close();
+  check(same, "read CHAIN.BIN back");
+  sd_sim_reset_stat();
+}
+
+static uint8_t
+multi_pattern(int file, uint32_t pos)
+{
+  return pattern(pos + file * 1000);
+}
+
+// SD_MAX_OPEN_FILES files written and read in turn, each keeps its own
+// position and partial block
+static void
+test_open_files(void)
+{
+  File f[SD_MAX_OPEN_FILES];
+  char name[13];
+  uint8_t buf[100];
+  bool ok = true;
+
+  for (int i = 0; i < SD_MAX_OPEN_FILES; i++) {
+    snprintf(name, sizeof(name), "MULTI%d.BIN", i);
+    f[i] = SD.open(name, FILE_WRITE);
+    ok = ok && f[i];
+  }
+  check(ok, "open SD_MAX_OPEN_FILES files");
+  File extra = SD.open("EXTRA.BIN", FILE_WRITE);
+  check(!extra, "one more file is not opened");
+  sd_sim_reset_stat();
+  for (uint32_t pos = 0; pos < MULTI_SIZE; pos += sizeof(buf)) {
+    uint32_t len = MULTI_SIZE - pos < sizeof(buf) ? MULTI_SIZE - pos : sizeof(buf);
+    for (int i = 0; i < SD_MAX_OPEN_FILES; i++) {
+      for (uint32_t j = 0; j < len; j++) buf[j] = multi_pattern(i, pos + j);
+      ok = ok && f[i].write(buf, len) == len;
+    }
+  }
+  check(ok, "write the files in turn");
+  // each partial block stays in its own data block of the cache
+  check(sd_sim_stat.cmd[CMD17] <= 2, "no data block read back while writing");
+  check(sd_sim_stat.blocks_written <=
+        SD_MAX_OPEN_FILES * (MULTI_SIZE / 512) + 8, "each data block written once");
+  report("write files in turn", SD_MAX_OPEN_FILES * MULTI_SIZE);
+  for (int i = 0; i < SD_MAX_OPEN_FILES; i++) f[i].close();
+
+  for (int i = 0; i < SD_MAX_OPEN_FILES; i++) {
+    snprintf(name, sizeof(name), "MULTI%d.BIN", i);
+    f[i] = SD.open(name);
+    ok = ok && f[i] && f[i].size() == MULTI_SIZE;
+  }
+  for (uint32_t pos = 0; ok && pos < MULTI_SIZE; pos += sizeof(buf)) {
+    uint32_t len = MULTI_SIZE - pos < sizeof(buf) ? MULTI_SIZE - pos : sizeof(buf);
+    for (int i = 0; ok && i < SD_MAX_OPEN_FILES; i++) {
+      ok = f[i].read(buf, len) == (int)len;
+      for (uint32_t j = 0; ok && j < len; j++) {
+        ok = buf[j] == multi_pattern(i, pos + j);
+      }
+    }
+  }
+  check(ok, "read the files back in turn");
+  check(sd_sim_stat.cmd[CMD17] <= SD_MAX_OPEN_FILES * (MULTI_SIZE / 512) + 4,
+        "each data block read once");
+  report("read files in turn", SD_MAX_OPEN_FILES * MULTI_SIZE);
+  for (int i = 0; i < SD_MAX_OPEN_FILES; i++) f[i].close();
+
+  extra = SD.open("EXTRA.BIN", FILE_WRITE);
+  check(extra, "a file opens again once one is closed");
+  extra.close();
+}
+
+static void
+run(bool fat32, uint32_t blocks)
+{
+  uint32_t file_blocks = FILE_SIZE / 512;
+
+  printf("FAT%d, %lu KB file\n", fat32 ? 32 : 16, FILE_SIZE / 1024);
+  if (!sd_sim_open(fat32 ? "sd32.img" : "sd16.img", blocks) ||
+      !sd_sim_format(fat32)) {
+    check(false, "create image");
+    return;
+  }
+  if (!SD.begin()) {
+    check(false, "SD.begin");
+    return;
+  }
+  sd_sim_reset_stat();
+
+  check(write_file("BULK.BIN", CHUNK), "write in 8 KB chunks");
+  check(sd_sim_stat.cmd[CMD25] > 0, "CMD25 used for whole blocks");
+  check(sd_sim_stat.blocks_written < file_blocks + 64, "blocks written");
+  report("write 8 KB chunks", FILE_SIZE);
+
+  check(write_file("SMALL.BIN", 100), "write in 100 byte chunks");
+  report("write 100 byte chunks", FILE_SIZE);
+
+  check(read_file("BULK.BIN", CHUNK), "read in 8 KB chunks");
+  check(sd_sim_stat.cmd[CMD18] > 0, "CMD18 used for whole blocks");
+  check(sd_sim_stat.blocks_read < file_blocks + 64, "blocks read");
+  report("read 8 KB chunks", FILE_SIZE);
+
+  check(read_file("SMALL.BIN", 100), "read in 100 byte chunks");
+  report("read 100 byte chunks", FILE_SIZE);
+
+  check(read_file("SMALL.BIN", 1536), "read in 1536 byte chunks");
+  report("read 1536 byte chunks", FILE_SIZE);
+
+  check(read_random("BULK.BIN"), "seek and read 3000 bytes");
+  report("seek and read", 50 * 3000);
+
+  test_cache();
+  test_open_files();
+  sd_sim_close();
+}
+
+// SD.begin() works once per process, the root directory stays open,
+// so each image is tested in a child
+static bool
+run_child(bool fat32, uint32_t blocks)
+{
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    run(fat32, blocks);
+    fflush(stdout);
+    _exit(failures ? 1 : 0);
+  }
+  int status;
+  return pid > 0 && waitpid(pid, &status, 0) == pid &&
+         WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int
+main(void)
+{
+  bool ok = run_child(false, 32768);
+  ok = run_child(true, 69632) && ok;
+  if (!ok) {
+    printf("checks failed\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+/* Host stand-in for the parts of Arduino.h used by the code under test */
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW  0
+#define INPUT  0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define OUTPUT_OPENDRAIN 3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define SS   10
+#define MOSI 11
+#define MISO 12
+#define SCK  13
+
+#define PCLK (48 * 1000 * 1000)
+
+// Pins used by the libraries under test, all on one dummy port
+#define PIN_IO0  0
+#define PIN_IO1  1
+#define PIN_IO4  4
+#define PIN_IO5  5
+#define PIN_IO6  6
+#define PIN_IO7  7
+#define PIN_IO8  8
+#define PIN_IO11 11
+#define PIN_IO12 12
+#define PIN_IO22 22
+#define PIN_IO23 23
+#define PIN_IO26 26
+#define PIN_IO29 29
+#define PIN_IO33 33
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern volatile uint8_t host_port[4];
+#ifdef __cplusplus
+}
+#endif
+#define digitalPinToPort(P) 0
+#define digitalPinToBit(P) ((P) & 7)
+#define portPullupControlRegister(P) ((void)(P), &host_port[0])
+#define portModeRegister(P) ((void)(P), &host_port[1])
+#define portOpendrainRegister(P, B) ((void)(P), &host_port[2])
+
+#define BSET(p, b) (*(p) |= (uint8_t)(1 << (b)))
+#define BCLR(p, b) (*(p) &= (uint8_t)~(1 << (b)))
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+#define noInterrupts()   do {} while (0)
+#define interrupts()     do {} while (0)
+#define isNoInterrupts() (0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+char *itoa(int value, char *s, int radix);
+char *ltoa(long value, char *s, int radix);
+char *utoa(unsigned int value, char *s, int radix);
+char *ultoa(unsigned long value, char *s, int radix);
+char *dtostrf(double value, signed char width, unsigned char prec, char *s);
+#ifdef __cplusplus
+}
+
+#include "WString.h"
+#include "Stream.h"
+
+// Console, prints to stdout
+class HostSerial : public Stream {
+public:
+  size_t write(uint8_t c);
+  using Print::write;
+  int available(void) { return 0; }
+  int read(void) { return -1; }
+  int peek(void) { return -1; }
+  void flush(void) {}
+};
+
+extern HostSerial Serial;
+#endif
+
+// RSPI0.SPCR, set by Sd2Card::init() for a chip select other than SS
+extern struct host_rspi {
+  struct { struct { uint8_t SPMS; } BIT; } SPCR;
+} RSPI0;
+
+#endif
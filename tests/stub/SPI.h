@@ -0,0 +1,48 @@
+/* Host stand-in for the SPI library, bytes go to the device model in
+   spi_host_device */
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0x00
+
+// Device on the bus: gets the byte sent and returns the byte received
+extern uint8_t (*spi_host_device)(uint8_t data);
+// Clock of the last beginTransaction(), to turn bus bytes into time
+extern uint32_t spi_host_clock;
+
+class SPISettings {
+public:
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : clock(clock) {}
+  SPISettings() : clock(4000000) {}
+private:
+  uint32_t clock;
+  friend class SPIClass;
+};
+
+class SPIClass {
+public:
+  static void begin() {}
+  static void end() {}
+  static void beginTransaction(SPISettings settings) {
+    spi_host_clock = settings.clock;
+  }
+  static void endTransaction(void) {}
+  static uint8_t transfer(uint8_t data) {
+    return spi_host_device(data);
+  }
+  static void transfer(const void *txBuffer, void *rxBuffer, size_t count) {
+    const uint8_t *tx = (const uint8_t *)txBuffer;
+    uint8_t *rx = (uint8_t *)rxBuffer;
+    for (size_t i = 0; i < count; i++) {
+      uint8_t b = spi_host_device(tx ? tx[i] : 0xff);
+      if (rx) rx[i] = b;
+    }
+  }
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,17 @@
+/* Host stand-in for avr/pgmspace.h, program memory is plain memory */
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const unsigned char *)(p))
+#define pgm_read_word(p) (*(const unsigned short *)(p))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strcmp_P strcmp
+#define memcpy_P memcpy
+
+#endif
@@ -0,0 +1,14 @@
+/* Host memory for the registers declared in stub/rx63n/iodefine.h */
+#include <Arduino.h>
+#include "rx63n/iodefine.h"
+#include "rx63n/util.h"
+
+volatile struct host_sci host_sci[13];
+volatile struct host_icu ICU;
+volatile struct host_system SYSTEM;
+volatile uint8_t host_port[4];
+
+void
+assignPinFunction(int pin, int psel, int isel, int asel)
+{
+}
@@ -0,0 +1,90 @@
+/* Host versions of the Arduino functions declared in stub/Arduino.h */
+#include <stdio.h>
+#include <time.h>
+#include <Arduino.h>
+
+HostSerial Serial;
+struct host_rspi RSPI0;
+
+size_t
+HostSerial::write(uint8_t c)
+{
+  return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t value) {}
+int digitalRead(uint8_t pin) { return LOW; }
+
+unsigned long
+micros(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+
+unsigned long
+millis(void)
+{
+  return micros() / 1000;
+}
+
+void
+delay(unsigned long ms)
+{
+  delayMicroseconds(ms * 1000);
+}
+
+void
+delayMicroseconds(unsigned int us)
+{
+  unsigned long t0 = micros();
+  while (micros() - t0 < us)
+    ;
+}
+
+char *
+ultoa(unsigned long value, char *s, int radix)
+{
+  char buf[8 * sizeof(value) + 1];
+  int i = 0;
+  do {
+    int d = value % radix;
+    buf[i++] = d < 10 ? '0' + d : 'a' + d - 10;
+    value /= radix;
+  } while (value);
+  for (int j = 0; j < i; j++) s[j] = buf[i - 1 - j];
+  s[i] = '\0';
+  return s;
+}
+
+char *
+utoa(unsigned int value, char *s, int radix)
+{
+  return ultoa(value, s, radix);
+}
+
+char *
+ltoa(long value, char *s, int radix)
+{
+  if (value < 0 && radix == 10) {
+    s[0] = '-';
+    ultoa(-(unsigned long)value, s + 1, radix);
+    return s;
+  }
+  return ultoa((unsigned long)value, s, radix);
+}
+
+char *
+itoa(int value, char *s, int radix)
+{
+  return ltoa(value, s, radix);
+}
+
+char *
+dtostrf(double value, signed char width, unsigned char prec, char *s)
+{
+  sprintf(s, "%*.*f", width, prec, value);
+  return s;
+}
@@ -0,0 +1,14 @@
+/* Host stand-in for rx63n/interrupt_handlers.h, handlers are plain
+   functions the tests call */
+#ifndef INTERRUPT_HANDLERS_H
+#define INTERRUPT_HANDLERS_H
+
+void INT_Excep_SCI0_TEI0(void);
+void INT_Excep_SCI1_TEI1(void);
+void INT_Excep_SCI2_TEI2(void);
+void INT_Excep_SCI3_TEI3(void);
+void INT_Excep_SCI5_TEI5(void);
+void INT_Excep_SCI6_TEI6(void);
+void INT_Excep_SCI8_TEI8(void);
+
+#endif
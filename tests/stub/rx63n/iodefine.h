@@ -0,0 +1,40 @@
+/* Host stand-in for the RX63N registers used by the code under test.
+   The SCI units keep the byte layout of the real ones, so the register
+   address arithmetic in twi_rx.h works on them. */
+#ifndef IODEFINE_H
+#define IODEFINE_H
+
+#include <stdint.h>
+
+struct host_sci {
+  uint8_t SMR, BRR, SCR, TDR, SSR, RDR, SCMR, SEMR, SNFR;
+  uint8_t SIMR1, SIMR2, SIMR3, SISR, SPMR;
+  uint8_t reserved[0x20 - 14];
+};
+
+struct host_icu {
+  uint8_t IR[256];
+  union { uint8_t BYTE; } IER[32];
+  struct { struct { uint8_t IPR; } BIT; } IPR[256];
+};
+
+struct host_system {
+  union { uint32_t LONG; } MSTPCRB;
+  union { uint32_t LONG; } MSTPCRC;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern volatile struct host_sci host_sci[13];
+extern volatile struct host_icu ICU;
+extern volatile struct host_system SYSTEM;
+#ifdef __cplusplus
+}
+#endif
+
+#define SCI0 host_sci[0]
+
+#define VECT_SCI0_RXI0 214
+
+#endif
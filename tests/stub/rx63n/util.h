@@ -0,0 +1,13 @@
+/* Host stand-in for rx63n/util.h */
+#ifndef UTIL_H
+#define UTIL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void assignPinFunction(int pin, int psel, int isel, int asel);
+#ifdef __cplusplus
+}
+#endif
+
+#endif
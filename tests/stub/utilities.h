@@ -0,0 +1 @@
+/* Host stand-in for utilities.h, nothing of it is needed on the host */
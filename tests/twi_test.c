@@ -0,0 +1,256 @@
+/*
+ * I2C transfer engine on a mock bus
+ *
+ * Runs queued transfers of twi_rx.c against host memory in place of the
+ * SCI registers. After each step of the engine the bus model works out
+ * what it asked for from the registers it wrote (start, restart, stop,
+ * a byte to send or one to receive), logs it, plays a slave device and
+ * raises the interrupt flag the SCI would, then lets twi_rx_poll() or
+ * the interrupt handlers take the next step.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <Arduino.h>
+#include "rx63n/iodefine.h"
+#include "twi_rx.h"
+
+#define IR_RXI(ch) ICU.IR[214 + (ch) * 3]
+#define IR_TXI(ch) ICU.IR[215 + (ch) * 3]
+#define IR_TEI(ch) ICU.IR[216 + (ch) * 3]
+
+// A slave with 256 byte registers like an EEPROM: the first byte
+// written sets the register pointer, the next ones are stored there
+static struct {
+  uint8_t address;
+  uint8_t mem[256];
+  uint8_t pointer;
+  int nak_after;      // Nak data bytes after this many, or -1
+  int written;
+  bool addressed;
+  bool reading;
+} dev;
+
+static char bus_log[512];
+static int failures;
+
+static void
+log_event(const char *s)
+{
+  if (bus_log[0]) strcat(bus_log, " ");
+  strcat(bus_log, s);
+}
+
+static void
+check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static void
+check_log(const char *expect, const char *what)
+{
+  if (strcmp(bus_log, expect) != 0) {
+    printf("FAIL: %s\n  bus    %s\n  expect %s\n", what, bus_log, expect);
+    failures++;
+  }
+  bus_log[0] = '\0';
+}
+
+// Drive channel ch until the engine stops asking for bus activity.
+// With use_isr the handlers are called directly instead of polling.
+static void
+run_bus(uint8_t ch, bool use_isr)
+{
+  volatile struct host_sci *sci = &host_sci[ch];
+  char s[16];
+  bool address_next = false;
+
+  for (int steps = 0; steps < 10000; steps++) {
+    uint8_t simr3 = sci->SIMR3;
+    bool tei = false, rxi = false, txi = false;
+
+    if (simr3 == 0x51 || simr3 == 0x52) {
+      log_event(simr3 == 0x51 ? "S" : "Sr");
+      address_next = true;
+      tei = true;
+    } else if (simr3 == 0x54) {
+      log_event("P");
+      dev.addressed = false;
+      tei = true;
+    } else if (simr3 == 0x07) {
+      // a byte to send, then the Ack/Nak cycle
+      uint8_t b = sci->TDR;
+      bool ack;
+      if (address_next) {
+        address_next = false;
+        ack = (b >> 1) == dev.address;
+        dev.addressed = ack;
+        dev.reading = b & 1;
+        dev.written = 0;
+      } else {
+        ack = dev.addressed && !dev.reading &&
+              (dev.nak_after < 0 || dev.written < dev.nak_after);
+        if (ack) {
+          if (dev.written++ == 0) {
+            dev.pointer = b;
+          } else {
+            dev.mem[dev.pointer++] = b;
+          }
+        }
+      }
+      snprintf(s, sizeof(s), "%02X%c", b, ack ? '+' : '-');
+      log_event(s);
+      sci->SISR = ack ? 0 : 1;
+      txi = true;
+    } else if (simr3 == 0xff && sci->TDR == 0xff) {
+      // dummy write to clock a byte in, SIMR2 bit 5 set for a Nak
+      bool nak = (sci->SIMR2 & 0x20) != 0;
+      check((sci->SCR & 0x40) != 0, "RIE set for a read");
+      sci->RDR = dev.mem[dev.pointer++];
+      snprintf(s, sizeof(s), "r%02X%c", sci->RDR, nak ? '-' : '+');
+      log_event(s);
+      rxi = true;
+      txi = true;
+    } else {
+      return;   // idle, or the bus is held for a restart
+    }
+
+    // sentinels, so the next step shows what the engine wrote
+    sci->SIMR3 = 0xff;
+    sci->TDR = 0x00;
+    if (use_isr) {
+      if (tei) twi_rx_sti(ch);
+      if (rxi) twi_rx_rxi(ch);
+      if (txi) twi_rx_txi(ch);
+    } else {
+      IR_TEI(ch) = tei;
+      IR_RXI(ch) = rxi;
+      IR_TXI(ch) = txi;
+      twi_rx_poll(ch);
+    }
+  }
+  check(false, "bus does not settle");
+}
+
+static int callbacks;
+static twi_rx_xfer_t *callback_order[8];
+
+static void
+on_done(twi_rx_xfer_t *x)
+{
+  callback_order[callbacks++] = x;
+}
+
+static void
+setup(twi_rx_xfer_t *x, uint8_t address, const uint8_t *tx, uint16_t txLength,
+      uint8_t *rx, uint16_t rxLength, bool sendStop)
+{
+  memset(x, 0, sizeof(*x));
+  x->address = address;
+  x->tx = tx;
+  x->txLength = txLength;
+  x->rx = rx;
+  x->rxLength = rxLength;
+  x->sendStop = sendStop;
+  x->callback = on_done;
+}
+
+static void
+start_device(void)
+{
+  dev.address = 0x3c;
+  dev.nak_after = -1;
+  dev.addressed = false;
+  for (int i = 0; i < 256; i++) dev.mem[i] = i ^ 0x5a;
+  callbacks = 0;
+}
+
+static void
+test_transfers(uint8_t ch, bool use_isr)
+{
+  twi_rx_xfer_t a, b, c;
+  uint8_t tx[4] = { 0x10, 0xaa, 0xbb, 0xcc };
+  uint8_t rx[4];
+
+  start_device();
+  twi_rx_init(ch, 100000);
+
+  // write with stop
+  setup(&a, 0x3c, tx, 4, NULL, 0, true);
+  check(twi_rx_submit(ch, &a), "submit write");
+  check(a.status == TWI_RX_STATUS_BUSY && twi_rx_isBusy(ch), "write on the bus");
+  run_bus(ch, use_isr);
+  check_log("S 78+ 10+ AA+ BB+ CC+ P", "write");
+  check(a.status == TWI_RX_STATUS_DONE && callbacks == 1, "write status");
+  check(dev.mem[0x10] == 0xaa && dev.mem[0x12] == 0xcc, "write data");
+  check(!twi_rx_isBusy(ch), "idle after write");
+
+  // register read: write the pointer, restart, read with Nak on the last
+  setup(&a, 0x3c, tx, 1, rx, 3, true);
+  twi_rx_submit(ch, &a);
+  run_bus(ch, use_isr);
+  check_log("S 78+ 10+ Sr 79+ rAA+ rBB+ rCC- P", "register read");
+  check(a.status == TWI_RX_STATUS_DONE && a.rxCount == 3, "register read status");
+  check(rx[0] == 0xaa && rx[1] == 0xbb && rx[2] == 0xcc, "register read data");
+
+  // read only
+  setup(&a, 0x3c, NULL, 0, rx, 1, true);
+  twi_rx_submit(ch, &a);
+  run_bus(ch, use_isr);
+  check_log("S 79+ r49- P", "read");
+  check(a.rxCount == 1 && rx[0] == 0x49, "read data");
+
+  // three queued at once: absent device, data Nak, then a good write
+  start_device();
+  dev.nak_after = 2;
+  setup(&a, 0x50, tx, 2, NULL, 0, true);
+  setup(&b, 0x3c, tx, 4, NULL, 0, true);
+  setup(&c, 0x3c, tx, 2, NULL, 0, true);
+  twi_rx_submit(ch, &a);
+  twi_rx_submit(ch, &b);
+  twi_rx_submit(ch, &c);
+  check(b.status == TWI_RX_STATUS_QUEUED && c.status == TWI_RX_STATUS_QUEUED,
+        "queued behind the first");
+  run_bus(ch, use_isr);
+  check_log("S A0- P S 78+ 10+ AA+ BB- P S 78+ 10+ AA+ P", "queue");
+  check(a.status == TWI_RX_STATUS_NACK_ADDR, "address Nak status");
+  check(b.status == TWI_RX_STATUS_NACK_DATA, "data Nak status");
+  check(c.status == TWI_RX_STATUS_DONE, "queue continues after a Nak");
+  check(callbacks == 3 && callback_order[0] == &a && callback_order[1] == &b &&
+        callback_order[2] == &c, "callbacks in order");
+
+  // no stop: the bus is kept and the next transfer starts with a restart
+  start_device();
+  setup(&a, 0x3c, tx, 1, NULL, 0, false);
+  twi_rx_submit(ch, &a);
+  run_bus(ch, use_isr);
+  check_log("S 78+ 10+", "write without stop");
+  check(a.status == TWI_RX_STATUS_DONE && !twi_rx_isBusy(ch), "bus kept");
+  setup(&a, 0x3c, NULL, 0, rx, 2, true);
+  twi_rx_submit(ch, &a);
+  run_bus(ch, use_isr);
+  check_log("Sr 79+ r4A+ r4B- P", "read after restart");
+
+  // events for an idle channel are not taken
+  check(!twi_rx_sti(ch) && !twi_rx_txi(ch) && !twi_rx_rxi(ch), "idle events");
+}
+
+int
+main(void)
+{
+  static const uint8_t channels[] = { 0, 2, 8 };
+
+  for (int i = 0; i < 3; i++) {
+    test_transfers(channels[i], false);
+    test_transfers(channels[i], true);
+  }
+  if (failures) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("all transfers on channels 0, 2 and 8 as expected\n");
+  return 0;
+}